@@ -0,0 +1,236 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <math.h>
+
+#include "../core/core.h"
+#include "../core/wl3.h"
+
+
+
+#define DEF_GCEL 30000  /** Most grid cells a generated part gets  **/
+#define DEF_REPS 5      /** Default number of runs per stage       **/
+
+
+
+/// xorshift32, so that the same seed gives the same file everywhere
+uint32_t Random(uint32_t *seed) {
+    *seed ^= *seed << 13;
+    *seed ^= *seed >> 17;
+    *seed ^= *seed << 5;
+    return *seed;
+}
+
+/// block sizes of a part with that many grid cells, each padded to 4 bytes;
+/// every 4th cell is split into 2 triangles, the rest are quads
+void PartSizes(long ccel, long gdim, long *tri, long *qua, long *vert, long bsiz[6]) {
+    *tri = ccel / 4 * 2;
+    *qua = ccel - ccel / 4;
+    *vert = (gdim + 1) * ((ccel + gdim - 1) / gdim + 1);
+    bsiz[0] = 2 + *tri * 6 + 2 + *qua * 8;
+    bsiz[1] = *vert * 6;
+    bsiz[2] = 2 + (*tri + *qua) * 4;
+    bsiz[3] = (*tri + *qua) * 3;
+    bsiz[4] = *tri * 9 + *qua * 12;
+    bsiz[5] = (*tri + *qua) * 2;
+    for (long iter = 0; iter < 6; iter++)
+        bsiz[iter] = (bsiz[iter] + 3) & ~3;
+}
+
+/// writes a valid WL3 of about cprm prims in at least cprt parts: each part
+/// is a bumpy square grid 4 units wide, and the parts are tiled side by
+/// side into a floor, so that the viewer shows something sensible as well
+bool MakeFile(char *name, long cprm, long cprt, uint32_t seed) {
+    long ccel = (cprm * 4 + 4) / 5, side, size, offs, tri, qua, vert, bsiz[6], tvtx = 0, tprm = 0;
+    struct WL3H *wl3h;
+    char *file;
+    FILE *fout;
+    bool retn;
+
+    if (cprt < (ccel + DEF_GCEL - 1) / DEF_GCEL)
+        cprt = (ccel + DEF_GCEL - 1) / DEF_GCEL;
+    if (cprt < 1)
+        cprt = 1;
+    for (side = 1; side * side < cprt; side++);
+
+    /// header, part table vector, parts, then the tail with nothing in it
+    size = sizeof(*wl3h) + 4 * cprt;
+    for (long iter = 0; iter < cprt; iter++) {
+        long pcel = ccel / cprt + (iter < ccel % cprt), gdim = ceil(sqrt(pcel));
+
+        PartSizes(pcel, (gdim) ? gdim : 1, &tri, &qua, &vert, bsiz);
+        size += sizeof(struct PART) + bsiz[0] + bsiz[1] + bsiz[2] + bsiz[3] + bsiz[4] + bsiz[5];
+    }
+    size += 4;
+    file = calloc(1, size);
+    wl3h = (void*)file;
+    wl3h->offsPart = U32_SWAP(sizeof(*wl3h));
+    wl3h->offsTail = U32_SWAP(size - 4);
+    wl3h->numPart = U32_SWAP(cprt);
+    memcpy(wl3h->name, "wcn-bench", sizeof("wcn-bench") - 1);
+    ((uint32_t*)(file + sizeof(*wl3h)))[0] = U32_SWAP(4 * cprt);
+
+    /// the last part goes right after the vector, the others follow it
+    offs = sizeof(*wl3h) + 4 * cprt;
+    for (long indx = 0; indx < cprt; indx++) {
+        long iter = (indx + cprt - 1) % cprt, pcel = ccel / cprt + (iter < ccel % cprt), gdim = ceil(sqrt(pcel));
+        struct PART *part = (void*)(file + offs);
+        char *bptr[6];
+
+        if (iter < cprt - 1)
+            ((uint32_t*)(file + sizeof(*wl3h)))[iter + 1] = U32_SWAP(offs - sizeof(*wl3h));
+        gdim = (gdim) ? gdim : 1;
+        PartSizes(pcel, gdim, &tri, &qua, &vert, bsiz);
+        bptr[0] = (char*)(part + 1);
+        for (long blck = 1; blck < 6; blck++)
+            bptr[blck] = bptr[blck - 1] + bsiz[blck - 1];
+        part->pidx = U32_SWAP(bptr[0] - (char*)part);
+        part->vert = U32_SWAP(bptr[1] - (char*)part);
+        part->texc = U32_SWAP(bptr[2] - (char*)part);
+        part->pnrm = U32_SWAP(bptr[3] - (char*)part);
+        part->vnrm = U32_SWAP(bptr[4] - (char*)part);
+        part->attr = U32_SWAP(bptr[5] - (char*)part);
+        part->numVert = U32_SWAP(vert);
+        part->numPrim = U32_SWAP(tri + qua);
+        /// a part spans 0x7FFF * 2 units of its scale (here 2), the offsets
+        /// are in 1 / (2 * 0x7FFFF) units
+        part->offset[0] = U32_SWAP(0x7FFFF * 2);
+        part->offset[1] = U32_SWAP(iter % side * 4 * (0x7FFFF * 2));
+        part->offset[3] = U32_SWAP(iter / side * 4 * (0x7FFFF * 2));
+        part->always0C = U16_SWAP(0x0C);
+        part->unk6[2] = U32_SWAP(-2);
+        snprintf((char*)part->tex, sizeof(part->tex), "bench%06ld", iter % 1000000);
+        tvtx += vert;
+        tprm += tri + qua;
+
+        /// indices: cell (x, y) has corners A = (x, y), B = (x + 1, y),
+        /// C = (x + 1, y + 1) and D = (x, y + 1), split as ABC + ACD
+        uint16_t *tidx = (uint16_t*)bptr[0] + 1, *qidx = tidx + tri * 3 + 1;
+        tidx[-1] = U16_SWAP(tri);
+        qidx[-1] = U16_SWAP(qua);
+        for (long cell = 0; cell < pcel; cell++) {
+            long crnr = cell / gdim * (gdim + 1) + cell % gdim,
+                 abcd[4] = {crnr, crnr + 1, crnr + gdim + 2, crnr + gdim + 1};
+
+            if (cell % 4 == 3)
+                for (long trio = 0; trio < 6; trio++)
+                    *tidx++ = U16_SWAP(abcd[(trio % 3) ? trio % 3 + trio / 3 : 0] << 1);
+            else
+                for (long trio = 0; trio < 4; trio++)
+                    *qidx++ = U16_SWAP(abcd[trio] << 1);
+        }
+
+        /// vertices, normals, colors
+        for (long iter = 0; iter < vert; iter++) {
+            int16_t *vpos = (int16_t*)bptr[1] + iter * 3;
+
+            vpos[0] = I16_SWAP(-0x7FFF + 0xFFFE * (iter % (gdim + 1)) / gdim);
+            vpos[1] = I16_SWAP((int16_t)(Random(&seed) % 0x800) - 0x400);
+            vpos[2] = I16_SWAP(-0x7FFF + 0xFFFE * (iter / (gdim + 1)) / gdim);
+        }
+        *(uint16_t*)bptr[2] = U16_SWAP(tri + qua);
+        for (long iter = 0; iter < tri + qua; iter++) {
+            bptr[3][iter * 3 + 0] = Random(&seed) % 32 - 16;
+            bptr[3][iter * 3 + 1] = -120;
+            bptr[3][iter * 3 + 2] = Random(&seed) % 32 - 16;
+            ((uint16_t*)bptr[5])[iter] = U16_SWAP(Random(&seed) & 0x7FFF);
+        }
+        for (long iter = 0; iter < tri * 3 + qua * 4; iter++)
+            bptr[4][iter * 3 + 1] = -127;
+        offs += sizeof(*part) + bsiz[0] + bsiz[1] + bsiz[2] + bsiz[3] + bsiz[4] + bsiz[5];
+    }
+    wl3h->numVert = U32_SWAP(tvtx);
+    wl3h->numPrim = U32_SWAP(tprm);
+
+    retn = false;
+    if ((fout = fopen(name, "wb"))) {
+        retn = fwrite(file, 1, size, fout) == size;
+        retn = !fclose(fout) && retn;
+    }
+    free(file);
+    printf("'%s': %ld bytes, %ld parts, %ld prims, %ld vertices\n", name, size, cprt, tprm, tvtx);
+    return retn;
+}
+
+
+
+void PrintStage(char *stag, uint64_t time, long reps, double size, long cprm) {
+    double secs = time / 1e9 / reps;
+
+    printf("  %-16s %10.3f ms %10.1f MB/s %10.2f Mprims/s\n",
+           stag, secs * 1e3, size / secs / 1e6, cprm / secs / 1e6);
+}
+
+/// every stage is run reps times over the whole file on one thread, so
+/// that the numbers are per core and do not depend on the part count;
+/// all but XML tags, which rDumpTags() spreads over every CPU there is,
+/// so its label says how many threads it had
+bool BenchFile(char *name, long reps) {
+    char *stag[BCH_LAST] = {[BCH_INDX] = "indices", [BCH_VERT] = "vertices",
+                            [BCH_NORM] = "normals", [BCH_CLRS] = "colors"};
+    uint64_t time[BCH_LAST], size[BCH_LAST], tbgn;
+    long flen = 0, cprm;
+    char tlbl[32];
+    int fnul;
+
+    tbgn = rTimeNow();
+    for (long iter = 0; iter < reps; iter++)
+        free(rLoadFile(name, &flen));
+    tbgn = rTimeNow() - tbgn;
+    if ((cprm = cBenchDecode(name, reps, time, size)) < 0)
+        return false;
+    printf("'%s': %ld bytes, %ld prims, %ld runs per stage\n", name, flen, cprm, reps);
+    PrintStage("rLoadFile", tbgn, reps, flen, cprm);
+    for (long iter = 0; iter < BCH_LAST; iter++)
+        PrintStage(stag[iter], time[iter], reps, size[iter], cprm);
+
+    if ((fnul = open("/dev/null", O_WRONLY)) < 0)
+        return false;
+    tbgn = rTimeNow();
+    for (long iter = 0; iter < reps; iter++)
+        rDumpTags(fnul, name, TAG_XML);
+    tbgn = rTimeNow() - tbgn;
+    snprintf(tlbl, sizeof(tlbl), "XML tags, %ld thr", rCountCPUs());
+    PrintStage(tlbl, tbgn, reps, flen, cprm);
+    close(fnul);
+    return true;
+}
+
+
+
+/// -g file: generate a file instead, of -n prims (1000 by default) in at
+/// least -p parts (1), from the -s seed; -r: runs per stage when benching
+int main(int argc, char *argv[]) {
+    long cprm = 1000, cprt = 1, reps = DEF_REPS;
+    uint32_t seed = 1;
+    char *make = 0;
+    int iter, retn = 0;
+
+    while ((iter = getopt(argc, argv, "g:n:p:s:r:")) != -1)
+        switch (iter) {
+            case 'g': make = optarg; break;
+            case 'n': cprm = atol(optarg); break;
+            case 'p': cprt = atol(optarg); break;
+            case 's': seed = strtoul(optarg, 0, 0); break;
+            case 'r': reps = atol(optarg); break;
+            default : exit(1);
+        }
+    if ((cprm < 0) || (cprt < 1) || (reps < 1) || !seed) {
+        printf("Invalid arguments! Exiting.\n");
+        exit(1);
+    }
+    if (make)
+        return (MakeFile(make, cprm, cprt, seed)) ? 0 : 2;
+    if (optind >= argc) {
+        printf("No input files specified! Exiting.\n");
+        exit(1);
+    }
+    for (; optind < argc; optind++)
+        if (!BenchFile(argv[optind], reps)) {
+            fprintf(stderr, "'%s': cannot load the file! Skipping.\n", argv[optind]);
+            retn = 2;
+        }
+    return retn;
+}
@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "../core/wl3.h"
+
+/** -s output formats **/
+enum {
+    STA_CSV,  /** CSV, with a header line                **/
+    STA_JSON, /** JSON lines, one per file               **/
+};
+
+typedef struct {
+    char **list;
+    FSTA *fsta;
+    bool *good;
+} SDAT;
+
+
+
+int PathOrder(const void *a, const void *b) {
+    return strcmp(*(char**)a, *(char**)b);
+}
+
+/// appends path to the list, or every .wl3 under it if it is a directory;
+/// what a directory yields is sorted, so that scans are reproducible
+void AddPath(char ***list, long *size, char *path) {
+    struct dirent *dent;
+    struct stat fsta;
+    long bgn, plen;
+    char *full;
+    DIR *dptr;
+
+    if (stat(path, &fsta) || !S_ISDIR(fsta.st_mode)) {
+        *list = realloc(*list, (*size + 1) * sizeof(**list));
+        (*list)[(*size)++] = strdup(path);
+        return;
+    }
+    if (!(dptr = opendir(path)))
+        return;
+    for (bgn = *size; (dent = readdir(dptr));) {
+        if (dent->d_name[0] == '.')
+            continue;
+        full = malloc(strlen(path) + strlen(dent->d_name) + 2);
+        sprintf(full, "%s/%s", path, dent->d_name);
+        if (!stat(full, &fsta) && (S_ISDIR(fsta.st_mode)
+        || (((plen = strlen(full)) > 4) && !strcasecmp(full + plen - 4, ".wl3"))))
+            AddPath(list, size, full);
+        free(full);
+    }
+    closedir(dptr);
+    qsort(*list + bgn, *size - bgn, sizeof(**list), PathOrder);
+}
+
+/// bytes that are not printable ASCII are escaped, as \xNN in CSV and as
+/// \u00NN in JSON; so are spaces in JSON, and in a CSV field where they
+/// separate items (sepr); quotes are doubled in CSV, as its text fields
+/// are all quoted, and JSON escapes them along with backslashes
+void PutText(uint8_t *text, long size, long sfmt, bool sepr) {
+    for (long iter = 0; (iter < size) && text[iter]; iter++)
+        if ((text[iter] < ' ') || (text[iter] >= 0x7F)
+        || ((text[iter] == ' ') && ((sfmt == STA_JSON) || sepr))
+        || ((sfmt == STA_JSON) && ((text[iter] == '"') || (text[iter] == '\\'))))
+            printf((sfmt == STA_JSON) ? "\\u%04X" : "\\x%02X", text[iter]);
+        else if (text[iter] == '"')
+            printf("\"\"");
+        else
+            putchar(text[iter]);
+}
+
+void PutStats(char *path, FSTA *fsta, long sfmt) {
+    if (sfmt == STA_JSON) {
+        printf("{\"file\":\"");
+        PutText((uint8_t*)path, strlen(path), sfmt, false);
+        printf("\",\"size\":%ld,\"offs_part\":%ld,\"offs_unk\":%ld,\"offs_coli\":%ld,\"offs_tail\":%ld,"
+               "\"hdr_parts\":%ld,\"hdr_verts\":%ld,\"hdr_prims\":%ld,\"hdr_size\":%ld,\"hdr_objs\":%ld,\"name\":\"",
+               fsta->flen, fsta->offs[0], fsta->offs[1], fsta->offs[2], fsta->offs[3],
+               fsta->hprt, fsta->hvtx, fsta->hprm, fsta->hsiz, fsta->hobj);
+        PutText((uint8_t*)fsta->name, sizeof(fsta->name), sfmt, false);
+        printf("\",\"parts\":%ld,\"tris\":%ld,\"quads\":%ld,\"verts\":%ld,\"bounds\":",
+               fsta->cprt, fsta->tri, fsta->qua, fsta->vtx);
+        if (!fsta->cbnd)
+            printf("null");
+        for (long iter = 0; fsta->cbnd && (iter < 6); iter++)
+            printf("%s%.6g", (iter) ? "," : "[", (iter < 3) ? fsta->bmin[iter] : fsta->bmax[iter - 3]);
+        printf("%s,\"textures\":[", (fsta->cbnd) ? "]" : "");
+        for (long iter = 0; iter < fsta->ctex; iter++) {
+            printf("%s\"", (iter) ? "," : "");
+            PutText(fsta->ptex[iter], sizeof(*fsta->ptex), sfmt, false);
+            printf("\"");
+        }
+        printf("],\"parse_us\":%.1f}\n", fsta->tpar / 1000.0);
+        return;
+    }
+    /// CSV: every text field is quoted as RFC 4180 has it, the path as is
+    putchar('"');
+    for (char *iter = path; *iter; iter++)
+        printf((*iter == '"') ? "\"\"" : "%c", *iter);
+    printf("\",%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%ld,\"",
+           fsta->flen, fsta->offs[0], fsta->offs[1], fsta->offs[2], fsta->offs[3],
+           fsta->hprt, fsta->hvtx, fsta->hprm, fsta->hsiz, fsta->hobj);
+    PutText((uint8_t*)fsta->name, sizeof(fsta->name), sfmt, false);
+    printf("\",%ld,%ld,%ld,%ld", fsta->cprt, fsta->tri, fsta->qua, fsta->vtx);
+    for (long iter = 0; iter < 6; iter++)
+        if (fsta->cbnd)
+            printf(",%.6g", (iter < 3) ? fsta->bmin[iter] : fsta->bmax[iter - 3]);
+        else
+            putchar(',');
+    printf(",\"");
+    for (long iter = 0; iter < fsta->ctex; iter++) {
+        if (iter)
+            putchar(' ');
+        PutText(fsta->ptex[iter], sizeof(*fsta->ptex), sfmt, true);
+    }
+    printf("\",%.1f\n", fsta->tpar / 1000.0);
+}
+
+void StatsFunc(void *user, long indx) {
+    SDAT *sdat = user;
+
+    sdat->good[indx] = rFileStats(&sdat->fsta[indx], sdat->list[indx]);
+}
+
+/// files are scanned in parallel, but reported in the order given
+int ScanFiles(char **list, long size, long sfmt) {
+    SDAT sdat = {list, calloc(size, sizeof(*sdat.fsta)), calloc(size, sizeof(*sdat.good))};
+    uint64_t time = rTimeNow();
+    int retn = 0;
+
+    rParallelFor(size, StatsFunc, &sdat);
+    time = rTimeNow() - time;
+    if (sfmt == STA_CSV)
+        printf("file,size,offs_part,offs_unk,offs_coli,offs_tail,hdr_parts,hdr_verts,hdr_prims,hdr_size,hdr_objs,"
+               "name,parts,tris,quads,verts,min_x,min_y,min_z,max_x,max_y,max_z,textures,parse_us\n");
+    for (long iter = 0; iter < size; iter++)
+        if (!sdat.good[iter]) {
+            fprintf(stderr, "'%s': cannot scan the file! Skipping.\n", list[iter]);
+            retn = 2;
+        }
+        else {
+            PutStats(list[iter], &sdat.fsta[iter], sfmt);
+            rFreeStats(&sdat.fsta[iter]);
+        }
+    fprintf(stderr, "%ld files scanned in %.3f s\n", size, time / 1e9);
+    free(sdat.good);
+    free(sdat.fsta);
+    return retn;
+}
+
+
+
+/// no window, no GL: just the file walked and tagged, so that batch jobs
+/// are bound by I/O alone; -s scans whole directories for stats instead
+int main(int argc, char *argv[]) {
+    char *tfmt[] = {[TAG_XML] = "xml", [TAG_JSON] = "json", [TAG_BIN] = "bin"},
+         *sfmt[] = {[STA_CSV] = "csv", [STA_JSON] = "json"}, **list = 0, *fsel = 0, *line = 0;
+    long ctfm = sizeof(tfmt) / sizeof(*tfmt), csfm = sizeof(sfmt) / sizeof(*sfmt), ffmt, size = 0;
+    int iter, retn = 0, scan = 0;
+    size_t llen = 0;
+    ssize_t lcur;
+
+    /// -f xml|json|bin: the tag format, or csv|json with -s
+    while ((iter = getopt(argc, argv, "f:s")) != -1)
+        if (iter == 'f')
+            fsel = optarg;
+        else if (iter == 's')
+            scan = 1;
+        else
+            exit(1);
+    for (ffmt = 0; fsel && (ffmt < ((scan) ? csfm : ctfm)) && strcmp(fsel, ((scan) ? sfmt : tfmt)[ffmt]); ffmt++);
+    if (ffmt == ((scan) ? csfm : ctfm)) {
+        fprintf(stderr, "'%s': unknown %s format! Exiting.\n", fsel, (scan) ? "stats" : "tag");
+        exit(1);
+    }
+    if (optind >= argc) {
+        printf("No input files specified! Exiting.\n");
+        exit(1);
+    }
+    if (scan) {
+        /// directories are searched for .wl3 files; '-' reads paths from stdin
+        for (; optind < argc; optind++)
+            if (strcmp(argv[optind], "-"))
+                AddPath(&list, &size, argv[optind]);
+            else
+                while ((lcur = getline(&line, &llen, stdin)) > 0) {
+                    for (; (lcur > 0) && ((line[lcur - 1] == '\n') || (line[lcur - 1] == '\r')); line[--lcur] = 0);
+                    if (lcur)
+                        AddPath(&list, &size, line);
+                }
+        retn = ScanFiles(list, size, ffmt);
+        while (size)
+            free(list[--size]);
+        free(list);
+        free(line);
+        return retn;
+    }
+    for (; optind < argc; optind++)
+        if (!rDumpTags(1, argv[optind], ffmt)) {
+            fprintf(stderr, "'%s': cannot load the file! Skipping.\n", argv[optind]);
+            retn = 2;
+        }
+    return retn;
+}
@@ -1,9 +1,28 @@
 #include "ogl_load/ogl_load.h"
 #include "vec_math/vec_math.h"
 #include "core.h"
+#include "wl3.h"
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0  /** macOS has SO_NOSIGPIPE instead       **/
+#endif
+#endif
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
 
 
 
@@ -13,20 +32,307 @@
 #define DEF_FANG  0.01  /** Default angular step             **/
 #define DEF_FTRN  0.05  /** Default translational step       **/
 
+#define DEF_STEP (DEF_UTMR * 1000000)  /** Simulation step, ns      **/
+#define DEF_SMAX  8     /** Most steps to catch up at once   **/
+
 #define DEF_FFOV 45.0   /** Default perspective view field   **/
 #define DEF_ZNEA  0.1   /** Default near clipping plane      **/
 #define DEF_ZFAR 90.0   /** Default far clipping plane       **/
 
+#define DEF_VCSZ 32     /** Vertex cache size to order for   **/
+#define DEF_ACSZ 16     /** Vertex cache size ACMR is for    **/
+
+#define DEF_LFRM  4     /** Frames latency is tracked for    **/
+#define DEF_LBKT 5000   /** Latency histogram buckets...     **/
+#define DEF_LRES 100000 /** ...and their width, ns           **/
+
+#define DEF_OFRM  4     /** Occlusion queries a part can wait on **/
+#define DEF_OVIS  8     /** Frames a visible part goes unchecked **/
+#define DEF_OMRG (DEF_ZNEA * 4)  /** Box margin the eye is inside by **/
+
+
+
+/// GL past 1.1 that the engine calls by itself: opengl32.dll exports none
+/// of it, and other platforms do not promise to, so LoadGL() fetches each
+/// entry point at run time into a pointer that the GL name then stands
+/// for; those marked 0 may be missing, as what uses them gets switched off
+#define GL_PROCS(F) \
+    F(PFNGLACTIVETEXTUREPROC,            glActiveTexture,            1) \
+    F(PFNGLATTACHSHADERPROC,             glAttachShader,             1) \
+    F(PFNGLBEGINCONDITIONALRENDERPROC,   glBeginConditionalRender,   1) \
+    F(PFNGLBEGINQUERYPROC,               glBeginQuery,               1) \
+    F(PFNGLBINDATTRIBLOCATIONPROC,       glBindAttribLocation,       1) \
+    F(PFNGLBINDBUFFERPROC,               glBindBuffer,               1) \
+    F(PFNGLBINDVERTEXARRAYPROC,          glBindVertexArray,          1) \
+    F(PFNGLBUFFERDATAPROC,               glBufferData,               1) \
+    F(PFNGLCOMPILESHADERPROC,            glCompileShader,            1) \
+    F(PFNGLCREATEPROGRAMPROC,            glCreateProgram,            1) \
+    F(PFNGLCREATESHADERPROC,             glCreateShader,             1) \
+    F(PFNGLDELETEBUFFERSPROC,            glDeleteBuffers,            1) \
+    F(PFNGLDELETEPROGRAMPROC,            glDeleteProgram,            1) \
+    F(PFNGLDELETEQUERIESPROC,            glDeleteQueries,            1) \
+    F(PFNGLDELETESHADERPROC,             glDeleteShader,             1) \
+    F(PFNGLDELETEVERTEXARRAYSPROC,       glDeleteVertexArrays,       1) \
+    F(PFNGLDETACHSHADERPROC,             glDetachShader,             1) \
+    F(PFNGLENABLEVERTEXATTRIBARRAYPROC,  glEnableVertexAttribArray,  1) \
+    F(PFNGLENDCONDITIONALRENDERPROC,     glEndConditionalRender,     1) \
+    F(PFNGLENDQUERYPROC,                 glEndQuery,                 1) \
+    F(PFNGLGENBUFFERSPROC,               glGenBuffers,               1) \
+    F(PFNGLGENQUERIESPROC,               glGenQueries,               1) \
+    F(PFNGLGENVERTEXARRAYSPROC,          glGenVertexArrays,          1) \
+    F(PFNGLGETINTEGER64VPROC,            glGetInteger64v,            0) \
+    F(PFNGLGETPROGRAMINFOLOGPROC,        glGetProgramInfoLog,        1) \
+    F(PFNGLGETPROGRAMIVPROC,             glGetProgramiv,             1) \
+    F(PFNGLGETQUERYOBJECTIVPROC,         glGetQueryObjectiv,         1) \
+    F(PFNGLGETQUERYOBJECTUI64VPROC,      glGetQueryObjectui64v,      0) \
+    F(PFNGLGETQUERYOBJECTUIVPROC,        glGetQueryObjectuiv,        1) \
+    F(PFNGLGETSHADERINFOLOGPROC,         glGetShaderInfoLog,         1) \
+    F(PFNGLGETSHADERIVPROC,              glGetShaderiv,              1) \
+    F(PFNGLGETSTRINGIPROC,               glGetStringi,               1) \
+    F(PFNGLGETUNIFORMLOCATIONPROC,       glGetUniformLocation,       1) \
+    F(PFNGLLINKPROGRAMPROC,              glLinkProgram,              1) \
+    F(PFNGLQUERYCOUNTERPROC,             glQueryCounter,             0) \
+    F(PFNGLSHADERSOURCEPROC,             glShaderSource,             1) \
+    F(PFNGLTEXBUFFERPROC,                glTexBuffer,                1) \
+    F(PFNGLUNIFORM1IPROC,                glUniform1i,                1) \
+    F(PFNGLUNIFORM3FPROC,                glUniform3f,                1) \
+    F(PFNGLUNIFORM3FVPROC,               glUniform3fv,               1) \
+    F(PFNGLUNIFORMMATRIX4FVPROC,         glUniformMatrix4fv,         1) \
+    F(PFNGLUSEPROGRAMPROC,               glUseProgram,               1) \
+    F(PFNGLVERTEXATTRIBIPOINTERPROC,     glVertexAttribIPointer,     1) \
+    F(PFNGLVERTEXATTRIBPOINTERPROC,      glVertexAttribPointer,      1)
+
+#define PROC_DECL(type, name, need) static type p##name;
+GL_PROCS(PROC_DECL)
+#undef PROC_DECL
+
+#define glActiveTexture            pglActiveTexture
+#define glAttachShader             pglAttachShader
+#define glBeginConditionalRender   pglBeginConditionalRender
+#define glBeginQuery               pglBeginQuery
+#define glBindAttribLocation       pglBindAttribLocation
+#define glBindBuffer               pglBindBuffer
+#define glBindVertexArray          pglBindVertexArray
+#define glBufferData               pglBufferData
+#define glCompileShader            pglCompileShader
+#define glCreateProgram            pglCreateProgram
+#define glCreateShader             pglCreateShader
+#define glDeleteBuffers            pglDeleteBuffers
+#define glDeleteProgram            pglDeleteProgram
+#define glDeleteQueries            pglDeleteQueries
+#define glDeleteShader             pglDeleteShader
+#define glDeleteVertexArrays       pglDeleteVertexArrays
+#define glDetachShader             pglDetachShader
+#define glEnableVertexAttribArray  pglEnableVertexAttribArray
+#define glEndConditionalRender     pglEndConditionalRender
+#define glEndQuery                 pglEndQuery
+#define glGenBuffers               pglGenBuffers
+#define glGenQueries               pglGenQueries
+#define glGenVertexArrays          pglGenVertexArrays
+#define glGetInteger64v            pglGetInteger64v
+#define glGetProgramInfoLog        pglGetProgramInfoLog
+#define glGetProgramiv             pglGetProgramiv
+#define glGetQueryObjectiv         pglGetQueryObjectiv
+#define glGetQueryObjectui64v      pglGetQueryObjectui64v
+#define glGetQueryObjectuiv        pglGetQueryObjectuiv
+#define glGetShaderInfoLog         pglGetShaderInfoLog
+#define glGetShaderiv              pglGetShaderiv
+#define glGetStringi               pglGetStringi
+#define glGetUniformLocation       pglGetUniformLocation
+#define glLinkProgram              pglLinkProgram
+#define glQueryCounter             pglQueryCounter
+#define glShaderSource             pglShaderSource
+#define glTexBuffer                pglTexBuffer
+#define glUniform1i                pglUniform1i
+#define glUniform3f                pglUniform3f
+#define glUniform3fv               pglUniform3fv
+#define glUniformMatrix4fv         pglUniformMatrix4fv
+#define glUseProgram               pglUseProgram
+#define glVertexAttribIPointer     pglVertexAttribIPointer
+#define glVertexAttribPointer      pglVertexAttribPointer
+
+
+
+#define DEF_CMAG 0x434E4357  /** Cache entry magic, 'WCNC'        **/
+#define DEF_CVER 6           /** Cache entry format version        **/
+#define DEF_CALN 16          /** Cache entry stream alignment      **/
+#define DEF_CEXT ".wcc"      /** Cache entry file extension        **/
+
+typedef struct {
+    uint64_t flen;  /** source file length                     **/
+    uint64_t mtim;  /** source file modification time          **/
+    uint64_t hash;  /** source file contents hash              **/
+} CKEY;
+
+typedef struct {
+    uint32_t magc, vers;        /** DEF_CMAG, DEF_CVER         **/
+    uint64_t flen, mtim, hash;  /** see CKEY                   **/
+    uint32_t plen, cvbo;        /** source path size, streams  **/
+    /// followed by CCHS[cvbo], the source path and the streams
+} CCHH;
+
+typedef struct {
+    uint32_t type, cdat;  /** OGL_UNIF::type, OGL_UNIF::cdat       **/
+    uint64_t offs;        /** offset from the start of the entry   **/
+} CCHS;
+
+/// the compact vertex stream, which is what the file has: positions are
+/// raw, the shader applies the scale & offset of part p to them
+typedef struct {
+    int16_t x, y, z, p;  /** position as in the file, part index     **/
+} VPOS;
+
+/// what the pixel shader fetches by gl_PrimitiveID, once per triangle
+typedef struct {
+    int16_t x, y, z;     /** prim normal as in the file             **/
+    uint16_t c;          /** 5-5-5 prim color as in the file        **/
+} VPRM;
+
+/// how a vertex stream is fed to its attribute
+typedef struct {
+    GLint size;          /** component count                        **/
+    GLenum type;         /** component type                         **/
+    GLboolean norm;      /** normalized to [-1; 1] or [0; 1]        **/
+    GLboolean intg;      /** left integer, via glVertexAttribIPointer **/
+} VFMT;
+
+/// buffer textures the shaders read from, in the order of texture units
+enum {
+    TBO_OFSC,  /** PRNG::ofsc of every part                          **/
+    TBO_FILE,  /** GPU-side decoding: the file as is, bytewise       **/
+    TBO_PDSC,  /** GPU-side decoding: block offsets and prim counts  **/
+    TBO_PRIM,  /** CPU-side decoding: VPRM of every triangle         **/
+    TBO_LAST
+};
 
+/// everything a model needs on the GPU: a VAO holding the index buffer
+/// (vbuf[0]) and the vertex streams (vbuf[1...cvbo - 1], one per attribute)
+typedef struct {
+    GLuint varr, *vbuf;
+    GLsizei cvbo, cind;
+    GLsizeiptr vram;
+} MESH;
+
+/// a part as the renderer sees it: where its triangles are in the element
+/// buffer, and the volumes they fit into (both empty for an empty part)
+typedef struct {
+    GLint offs;           /** first index of the part               **/
+    GLsizei size;         /** index count of the part               **/
+    VEC_T3FV bmin, bmax;  /** axis-aligned bounding box             **/
+    VEC_T3FV cntr;        /** bounding sphere center...             **/
+    GLfloat rads;         /** ...and radius                         **/
+    VEC_T4FV ofsc;        /** position offset (xyz) and scale (w)   **/
+} PRNG;
+
+/** debug views, F3 to F6 turn them on and off **/
+enum {
+    DBG_NONE, /** lit as usual                            **/
+    DBG_WIRE, /** triangle edges only                     **/
+    DBG_OVER, /** overdraw: every fragment adds up        **/
+    DBG_PART, /** every part in a color of its own        **/
+    DBG_DENS, /** every triangle corner adds up           **/
+    DBG_LAST
+};
+
+/** latency histograms **/
+enum {
+    LAT_DRAW, /** input to the end of cRedrawWindow()     **/
+    LAT_SWAP, /** input to cSwapDone()                    **/
+    LAT_GPUD, /** input to the GPU finishing the frame    **/
+    LAT_GPUT, /** GPU time of the frame itself            **/
+    LAT_LAST
+};
+
+/// a frame on its way to the screen: the input it is the first to show,
+/// and the GPU timestamps taken before and after its draw calls
+typedef struct {
+    uint64_t tinp;        /** input time, 0 when there was none     **/
+    GLuint tqry[2];       /** GL_TIMESTAMP queries                  **/
+    bool busy;            /** queries issued, results pending       **/
+} LFRM;
+
+typedef struct {
+    uint32_t bkts[DEF_LBKT];  /** the last one also takes all longer  **/
+    uint64_t cnts;
+} LHST;
+
+/// a part's occlusion queries: results come some frames late, so they
+/// are a ring, and the last one read back is taken for the visibility
+typedef struct {
+    GLuint oqry[DEF_OFRM];/** GL_(ANY_)SAMPLES_PASSED queries...    **/
+    long odrw, ored;      /** ...issued and read back, counted on   **/
+    bool ovis;            /** visible as of the last result         **/
+    bool ohid, ocnd;      /** in view but hidden this frame, and
+                              got a box query to be drawn after     **/
+} OCCL;
+
+/// what the metrics socket serves, as of the last frame drawn
+typedef struct {
+    uint64_t frms;        /** frames drawn so far                   **/
+    uint64_t tfrm, tcpu;  /** time between the last two frames, and
+                              the CPU time the last one took, ns    **/
+    double fps;           /** frames per second, over the last one  **/
+    long cdrw, cvis, cprt;/** draw calls, visible and all parts     **/
+    long cocc;            /** parts in view that are occluded       **/
+    long tdrw, tcul;      /** triangles drawn and culled            **/
+    long vram;            /** bytes held in GL buffers              **/
+    uint64_t timp;        /** time the model took to import, ns     **/
+} MSTA;
 
 struct ENGC {
     VEC_FMST *view, *proj;
 
-    OGL_FVBO *fvbo;
+    MESH *mesh;
+    GLuint prog, tbuf[TBO_LAST], ttex[TBO_LAST];
+    GLint umvp, uftr, uprt, upbs, udbg;
+    long dbug;            /** debug view, one of DBG_*              **/
+
+    PRNG *prng;
+    long cprt;
+    long cvis, cdrw, cdix;  /** visible parts, draw calls and indices
+                                drawn in the last frame, for F1 stats **/
+
+    OCCL *occl;           /** per part, 0 with no occlusion culling **/
+    long cocc, ofrm;      /** parts in view occluded, frame count   **/
+    GLuint oprg, ovao;    /** bounding box program and its VAO      **/
+    GLint obmn, obmx, omvp;
+    GLenum otyp;
 
     VEC_T2IV angp;
     VEC_T2FV fang;
-    VEC_T3FV ftrn;
+    VEC_T3FV ftrn, fprv;  /** position after the last step and before
+                              it, to draw what lies in between      **/
+    uint64_t tlst, tacc;  /** time of the last update (0 when still),
+                              and how far it was past the last step **/
+
+    uint64_t tinp, tfrm;  /** first input not drawn yet, and the one
+                              the last frame drew; 0 if none        **/
+    LFRM lfrm[DEF_LFRM];  /** frames in flight, a ring...           **/
+    long ldrw, lswp;      /** ...timed and read back, counted on    **/
+    bool ltim, lcur;      /** GL_TIMESTAMP queries are there, and
+                              the last frame got them               **/
+    LHST lhst[LAT_LAST];
+#ifdef PRF_ZONES
+    GLuint gqry[DEF_LFRM];  /** GL_TIME_ELAPSED queries, a ring...  **/
+    uint64_t gbgn[DEF_LFRM];/** ...the times they were issued at... **/
+    long gdrw, gred;        /** ...issued and read back, counted on **/
+    uint64_t gend;          /** where the last GPU zone ended       **/
+    bool gcur;              /** the frame being drawn got a query   **/
+#endif
+
+    MSTA msta;            /** metrics the render thread keeps...    **/
+    uint64_t mfps[3];     /** ...last frame time, FPS window start
+                              time and frame count at that time...  **/
+    long ctri;            /** ...all the triangles there are...     **/
+#ifndef _WIN32
+    MSTA mpub;            /** ...and what the socket thread reads,
+                              a seqlock: mseq is odd while writing  **/
+    atomic_ulong mseq;
+    pthread_t mthr;
+    char *mpth;           /** socket path, 0 when not serving       **/
+    atomic_bool mstp;     /** the socket thread has to exit         **/
+    int msck;
+#endif
 
     GLboolean keys[KEY_ALL_KEYS];
 };
@@ -72,29 +378,392 @@ OGL_FTEX *MakeTileTex(GLuint size, GLuint tile, GLuint tbdr) {
 
 
 
-void cUpdateState(ENGC *engc) {
+GLuint MakeShader(GLenum type, char *text) {
+    GLchar elog[1024];
+    GLuint retn;
+    GLint stat;
+
+    retn = glCreateShader(type);
+    glShaderSource(retn, 1, (const GLchar**)&text, 0);
+    glCompileShader(retn);
+    glGetShaderiv(retn, GL_COMPILE_STATUS, &stat);
+    if (!stat) {
+        glGetShaderInfoLog(retn, sizeof(elog), 0, elog);
+        printf("%s shader: %s\n", (type == GL_VERTEX_SHADER) ? "vertex" : "pixel", elog);
+    }
+    return retn;
+}
+
+/// attributes get their locations in the order they follow in uvbo[], and
+/// the pixel shader is expected to have a single output
+GLuint MakeProgram(char *vert, char *frag, OGL_UNIF *uvbo, long cvbo) {
+    PRF_BGN(zone);
+    GLuint retn, vshd, fshd;
+    GLchar elog[1024];
+    GLint stat;
+
+    retn = glCreateProgram();
+    glAttachShader(retn, vshd = MakeShader(GL_VERTEX_SHADER, vert));
+    glAttachShader(retn, fshd = MakeShader(GL_FRAGMENT_SHADER, frag));
+    for (long iter = 0; iter < cvbo; iter++)
+        glBindAttribLocation(retn, iter, uvbo[iter].name);
+    glLinkProgram(retn);
+    glDetachShader(retn, vshd);
+    glDetachShader(retn, fshd);
+    glDeleteShader(vshd);
+    glDeleteShader(fshd);
+    glGetProgramiv(retn, GL_LINK_STATUS, &stat);
+    if (!stat) {
+        glGetProgramInfoLog(retn, sizeof(elog), 0, elog);
+        printf("program: %s\n", elog);
+    }
+    PRF_END(zone, "MakeProgram");
+    return retn;
+}
+
+/// uvbo[0] holds GLuint triangle indices, the rest are vertex streams with
+/// their formats in vfmt[0...cvbo - 2]
+MESH *MakeMesh(OGL_UNIF *uvbo, VFMT *vfmt, long cvbo) {
+    PRF_BGN(zone);
+    MESH *retn = calloc(1, sizeof(*retn));
+
+    retn->cvbo = cvbo;
+    retn->vbuf = calloc(cvbo, sizeof(*retn->vbuf));
+    glGenVertexArrays(1, &retn->varr);
+    glBindVertexArray(retn->varr);
+    glGenBuffers(cvbo, retn->vbuf);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, retn->vbuf[0]);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, uvbo[0].cdat, uvbo[0].pdat, uvbo[0].draw);
+    retn->cind = uvbo[0].cdat / sizeof(GLuint);
+    retn->vram = uvbo[0].cdat;
+    for (long iter = 1; iter < cvbo; iter++) {
+        glBindBuffer(GL_ARRAY_BUFFER, retn->vbuf[iter]);
+        glBufferData(GL_ARRAY_BUFFER, uvbo[iter].cdat, uvbo[iter].pdat, uvbo[iter].draw);
+        glEnableVertexAttribArray(iter - 1);
+        if (vfmt[iter - 1].intg)
+            glVertexAttribIPointer(iter - 1, vfmt[iter - 1].size, vfmt[iter - 1].type, 0, 0);
+        else
+            glVertexAttribPointer(iter - 1, vfmt[iter - 1].size, vfmt[iter - 1].type, vfmt[iter - 1].norm, 0, 0);
+        retn->vram += uvbo[iter].cdat;
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    PRF_END(zone, "MakeMesh");
+    return retn;
+}
+
+/// draws size indices starting from offs, as triangles; meshes with no
+/// indices have their vertices pulled by the shader from gl_VertexID
+void DrawMesh(MESH *mesh, GLint offs, GLsizei size) {
+    glBindVertexArray(mesh->varr);
+    if (mesh->cind)
+        glDrawElements(GL_TRIANGLES, size, GL_UNSIGNED_INT, (GLvoid*)(offs * sizeof(GLuint)));
+    else
+        glDrawArrays(GL_TRIANGLES, offs, size);
+    glBindVertexArray(0);
+}
+
+/// a buffer texture of format ifmt over a copy of data
+GLuint MakeTBuf(GLenum ifmt, void *data, GLsizeiptr size, GLuint *tbuf) {
+    PRF_BGN(zone);
+    GLuint retn;
+
+    glGenBuffers(1, tbuf);
+    glBindBuffer(GL_TEXTURE_BUFFER, *tbuf);
+    glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    glGenTextures(1, &retn);
+    glBindTexture(GL_TEXTURE_BUFFER, retn);
+    glTexBuffer(GL_TEXTURE_BUFFER, ifmt, *tbuf);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    PRF_END(zone, "MakeTBuf");
+    return retn;
+}
+
+/// Gribb & Hartmann: the planes are sums and differences of the rows of
+/// the MVP matrix, normalized so that the sphere test gets true distances
+void FrustumPlanes(VEC_TMFV mmvp, VEC_T4FV *fpln) {
+    GLfloat norm;
+
+    for (long iter = 0; iter < 6; iter++) {
+        for (long indx = 0; indx < 4; indx++)
+            fpln[iter].v[indx] = mmvp[indx * 4 + 3]
+                               + ((iter & 1) ? -mmvp[indx * 4 + (iter >> 1)] : mmvp[indx * 4 + (iter >> 1)]);
+        norm = 1.0 / sqrtf(fpln[iter].x * fpln[iter].x + fpln[iter].y * fpln[iter].y
+                         + fpln[iter].z * fpln[iter].z);
+        for (long indx = 0; indx < 4; indx++)
+            fpln[iter].v[indx] *= norm;
+    }
+}
+
+/// the sphere settles most parts at once, the box gets checked only for
+/// those the sphere straddles a plane of, by its most positive vertex
+bool PartVisible(PRNG *prng, VEC_T4FV *fpln) {
+    GLfloat dist;
+
+    for (long iter = 0; iter < 6; iter++) {
+        dist = fpln[iter].x * prng->cntr.x + fpln[iter].y * prng->cntr.y
+             + fpln[iter].z * prng->cntr.z + fpln[iter].w;
+        if (dist < -prng->rads)
+            return false;
+        if (dist >= prng->rads)
+            continue;
+        dist = fpln[iter].x * ((fpln[iter].x < 0) ? prng->bmin.x : prng->bmax.x)
+             + fpln[iter].y * ((fpln[iter].y < 0) ? prng->bmin.y : prng->bmax.y)
+             + fpln[iter].z * ((fpln[iter].z < 0) ? prng->bmin.z : prng->bmax.z) + fpln[iter].w;
+        if (dist < 0)
+            return false;
+    }
+    return true;
+}
+
+void FreeMesh(MESH **mesh) {
+    if (!*mesh)
+        return;
+    glDeleteBuffers((*mesh)->cvbo, (*mesh)->vbuf);
+    glDeleteVertexArrays(1, &(*mesh)->varr);
+    free((*mesh)->vbuf);
+    free(*mesh);
+    *mesh = 0;
+}
+
+
+
+void LatencyAdd(LHST *lhst, uint64_t time) {
+    time /= DEF_LRES;
+    lhst->bkts[(time < DEF_LBKT) ? time : DEF_LBKT - 1]++;
+    lhst->cnts++;
+}
+
+/// nearest-rank percentile, as the upper edge of its bucket, in ms
+double LatencyPart(LHST *lhst, double prct) {
+    uint64_t rank = ceil(prct / 100.0 * lhst->cnts), summ = 0;
+    long iter;
+
+    for (iter = 0; (iter < DEF_LBKT - 1) && ((summ += lhst->bkts[iter]) < rank); iter++);
+    return (iter + 1) * DEF_LRES / 1e6;
+}
+
+void LatencyReport(ENGC *engc) {
+    char *name[LAT_LAST] = {[LAT_DRAW] = "input to draw", [LAT_SWAP] = "input to swap",
+                            [LAT_GPUD] = "input to GPU done", [LAT_GPUT] = "GPU frame time"};
+
+    for (long iter = 0; iter < LAT_LAST; iter++)
+        if (engc->lhst[iter].cnts)
+            printf("%-17s %8lu samples: p50 %.1f, p95 %.1f, p99 %.1f ms\n", name[iter],
+                   (unsigned long)engc->lhst[iter].cnts, LatencyPart(&engc->lhst[iter], 50.0),
+                   LatencyPart(&engc->lhst[iter], 95.0), LatencyPart(&engc->lhst[iter], 99.0));
+}
+
+/// takes in whatever frames the GPU is done with, never waiting for any;
+/// its clock is mapped onto rTimeNow() by reading both at the same moment
+void LatencyPoll(ENGC *engc, bool wait) {
+    uint64_t tbgn, tend;
+    GLint64 tgpu;
+    int64_t tofs;
+    GLint done;
+    LFRM *lfrm;
+
+    if (!engc->ltim)
+        return;
+    glGetInteger64v(GL_TIMESTAMP, &tgpu);
+    tofs = (int64_t)rTimeNow() - tgpu;
+    for (; engc->lswp < engc->ldrw; engc->lswp++) {
+        lfrm = &engc->lfrm[engc->lswp % DEF_LFRM];
+        if (!wait) {
+            glGetQueryObjectiv(lfrm->tqry[1], GL_QUERY_RESULT_AVAILABLE, &done);
+            if (!done)
+                break;
+        }
+        glGetQueryObjectui64v(lfrm->tqry[0], GL_QUERY_RESULT, &tbgn);
+        glGetQueryObjectui64v(lfrm->tqry[1], GL_QUERY_RESULT, &tend);
+        LatencyAdd(&engc->lhst[LAT_GPUT], tend - tbgn);
+        if (lfrm->tinp && ((int64_t)tend + tofs > (int64_t)lfrm->tinp))
+            LatencyAdd(&engc->lhst[LAT_GPUD], tend + tofs - lfrm->tinp);
+        lfrm->busy = false;
+    }
+}
+
+
+
+#ifdef PRF_ZONES
+/// GL_TIME_ELAPSED only says how long the GPU took, so a zone is put at
+/// the time its queries were issued, or right after the previous zone if
+/// the GPU was still busy with that: frames run on it one after another
+void GPUZones(ENGC *engc, bool wait) {
+    GLuint64 tdur;
+    GLint done;
+
+    for (; engc->gred < engc->gdrw; engc->gred++) {
+        if (!wait) {
+            glGetQueryObjectiv(engc->gqry[engc->gred % DEF_LFRM], GL_QUERY_RESULT_AVAILABLE, &done);
+            if (!done)
+                break;
+        }
+        glGetQueryObjectui64v(engc->gqry[engc->gred % DEF_LFRM], GL_QUERY_RESULT, &tdur);
+        if (engc->gend < engc->gbgn[engc->gred % DEF_LFRM])
+            engc->gend = engc->gbgn[engc->gred % DEF_LFRM];
+        rZoneAdd("cRedrawWindow", true, engc->gend, engc->gend + tdur);
+        engc->gend += tdur;
+    }
+}
+#endif
+
+
+
+/// called at the end of every frame; readers never hold the writer up,
+/// they retry instead if the snapshot changed while they were copying it
+void MetricsPut(ENGC *engc, uint64_t tbgn) {
+    MSTA *msta = &engc->msta;
+    uint64_t tnow = rTimeNow();
+#ifndef _WIN32
+    unsigned long mseq;
+#endif
+
+    msta->tfrm = (msta->frms) ? tnow - engc->mfps[0] : 0;
+    msta->tcpu = tnow - tbgn;
+    engc->mfps[0] = tnow;
+    /// FPS counts frames over a window of a second or more, which restarts
+    /// when it is over; frames that come rarer make the window longer
+    if (!msta->frms++) {
+        engc->mfps[1] = tnow;
+        engc->mfps[2] = msta->frms;
+    }
+    else if (tnow - engc->mfps[1] >= 1000000000) {
+        msta->fps = 1e9 * (msta->frms - engc->mfps[2]) / (tnow - engc->mfps[1]);
+        engc->mfps[1] = tnow;
+        engc->mfps[2] = msta->frms;
+    }
+    msta->cdrw = engc->cdrw;
+    msta->cvis = engc->cvis;
+    msta->cocc = engc->cocc;
+    msta->tdrw = engc->cdix / 3;
+    msta->tcul = engc->ctri - msta->tdrw;
+#ifndef _WIN32
+    if (!engc->mpth)
+        return;
+    mseq = atomic_load_explicit(&engc->mseq, memory_order_relaxed);
+    atomic_store_explicit(&engc->mseq, mseq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    engc->mpub = *msta;
+    atomic_store_explicit(&engc->mseq, mseq + 2, memory_order_release);
+#endif
+}
+
+
+
+#ifndef _WIN32
+/// resident set size from /proc, where there is one; 0 elsewhere
+long MetricsRSS(void) {
+    long size = 0, rss = 0;
+    FILE *file;
+
+    if ((file = fopen("/proc/self/statm", "r"))) {
+        if (fscanf(file, "%ld %ld", &size, &rss) != 2)
+            rss = 0;
+        fclose(file);
+    }
+    return rss * sysconf(_SC_PAGESIZE);
+}
+
+/// every client gets one JSON line, as of the last frame, and is closed
+void *MetricsFunc(void *user) {
+    ENGC *engc = user;
+    unsigned long mseq;
+    char line[1024];
+    MSTA msta;
+    long size;
+    int csck;
+
+    while ((csck = accept(engc->msck, 0, 0)) >= 0) {
+        if (atomic_load(&engc->mstp)) {
+            close(csck);
+            break;
+        }
+#ifdef SO_NOSIGPIPE
+        setsockopt(csck, SOL_SOCKET, SO_NOSIGPIPE, &(int){1}, sizeof(int));
+#endif
+        do {
+            mseq = atomic_load_explicit(&engc->mseq, memory_order_acquire);
+            msta = engc->mpub;
+            atomic_thread_fence(memory_order_acquire);
+        } while ((mseq & 1) || (mseq != atomic_load_explicit(&engc->mseq, memory_order_relaxed)));
+        size = snprintf(line, sizeof(line),
+                        "{\"frames\":%llu,\"frame_ms\":%.3f,\"cpu_ms\":%.3f,\"fps\":%.1f,"
+                        "\"draw_calls\":%ld,\"parts_visible\":%ld,\"parts_occluded\":%ld,\"parts\":%ld,"
+                        "\"tris_drawn\":%ld,\"tris_culled\":%ld,\"vram\":%ld,"
+                        "\"import_ms\":%.3f,\"rss\":%ld}\n",
+                        (unsigned long long)msta.frms, msta.tfrm / 1e6, msta.tcpu / 1e6, msta.fps,
+                        msta.cdrw, msta.cvis, msta.cocc, msta.cprt, msta.tdrw, msta.tcul, msta.vram,
+                        msta.timp / 1e6, MetricsRSS());
+        if (send(csck, line, size, MSG_NOSIGNAL) != size)
+            size = 0;
+        close(csck);
+    }
+    return 0;
+}
+#endif
+
+
+
+/// the input calls below return true when what is on screen has to
+/// change, so that front ends only redraw when there is something new;
+/// this one also returns false when no key is held that moves the camera,
+/// which means it need not be called again until cKbdInput() says so
+///
+/// the camera moves in fixed steps of DEF_STEP of real time, however often
+/// this gets called; after a stall it catches up by DEF_SMAX steps at most
+/// and drops the rest, and the first step is taken right when motion starts;
+/// when it stops, the step last taken is still drawn to its end, so that
+/// the camera does not jump there, and only then is it false
+bool cUpdateState(ENGC *engc) {
+    uint64_t tnow = rTimeNow();
+    PRF_BGN(zone);
     VEC_T3FV vadd;
     VEC_T2FV fang;
+    bool retn;
 
-    if (engc->keys[KEY_W] ^ engc->keys[KEY_S]) {
-        fang = (VEC_T2FV){{engc->fang.x + 0.5 * M_PI, engc->fang.y}};
-        VEC_V3FromAng(&vadd, &fang);
-        VEC_V3MulC(&vadd, (engc->keys[KEY_W])? DEF_FTRN : -DEF_FTRN);
-        VEC_V3AddV(&engc->ftrn, &vadd);
+    if (!(engc->keys[KEY_W] ^ engc->keys[KEY_S]) && !(engc->keys[KEY_A] ^ engc->keys[KEY_D])) {
+        if (!(retn = engc->tlst && ((int64_t)(tnow - engc->tlst + engc->tacc) < DEF_STEP))) {
+            engc->fprv = engc->ftrn;
+            engc->tlst = engc->tacc = 0;
+        }
+        PRF_END(zone, "cUpdateState");
+        return retn;
     }
-    if (engc->keys[KEY_A] ^ engc->keys[KEY_D]) {
-        fang = (VEC_T2FV){{engc->fang.x, 0.0}};
-        VEC_V3FromAng(&vadd, &fang);
-        VEC_V3MulC(&vadd, (engc->keys[KEY_A])? DEF_FTRN : -DEF_FTRN);
-        VEC_V3AddV(&engc->ftrn, &vadd);
+    engc->tacc = (engc->tlst) ? engc->tacc + tnow - engc->tlst : DEF_STEP;
+    engc->tlst = tnow;
+    if (engc->tacc > DEF_SMAX * DEF_STEP)
+        engc->tacc = DEF_SMAX * DEF_STEP;
+    for (; engc->tacc >= DEF_STEP; engc->tacc -= DEF_STEP) {
+        engc->fprv = engc->ftrn;
+        if (engc->keys[KEY_W] ^ engc->keys[KEY_S]) {
+            fang = (VEC_T2FV){{engc->fang.x + 0.5 * M_PI, engc->fang.y}};
+            VEC_V3FromAng(&vadd, &fang);
+            VEC_V3MulC(&vadd, (engc->keys[KEY_W])? DEF_FTRN : -DEF_FTRN);
+            VEC_V3AddV(&engc->ftrn, &vadd);
+        }
+        if (engc->keys[KEY_A] ^ engc->keys[KEY_D]) {
+            fang = (VEC_T2FV){{engc->fang.x, 0.0}};
+            VEC_V3FromAng(&vadd, &fang);
+            VEC_V3MulC(&vadd, (engc->keys[KEY_A])? DEF_FTRN : -DEF_FTRN);
+            VEC_V3AddV(&engc->ftrn, &vadd);
+        }
     }
+    PRF_END(zone, "cUpdateState");
+    return true;
 }
 
 
 
-void cMouseInput(ENGC *engc, long xpos, long ypos, long btns) {
+/// time is rTimeNow() as of when the event came, which the caller has to
+/// take itself: by the time the event gets here it may have waited a lot
+bool cMouseInput(ENGC *engc, long xpos, long ypos, long btns, uint64_t time) {
+    bool retn;
+
     if (~btns & 2)
-        return;
+        return false;
+    retn = (btns & 1) && ((xpos != engc->angp.x) || (ypos != engc->angp.y));
     if (btns & 1) { /** 1 for moving state, 2 for LMB **/
         engc->fang.y += DEF_FANG * (GLfloat)(ypos - engc->angp.y);
         if (engc->fang.y < -M_PI) engc->fang.y += 2.0 * M_PI;
@@ -105,17 +774,47 @@ void cMouseInput(ENGC *engc, long xpos, long ypos, long btns) {
         else if (engc->fang.x > M_PI) engc->fang.x -= 2.0 * M_PI;
     }
     engc->angp = (VEC_T2IV){{xpos, ypos}};
+    if (retn && !engc->tinp)
+        engc->tinp = time;
+    return retn;
 }
 
 
 
-void cKbdInput(ENGC *engc, uint8_t code, long down) {
+/// true when a key that cUpdateState() looks at has changed its state,
+/// or the view has; F1 prints what the last frame drew, F2 the latencies
+/// so far, F3 to F6 switch to a debug view and back; time is as above
+bool cKbdInput(ENGC *engc, uint8_t code, long down, uint64_t time) {
+    bool retn = (code == KEY_W) || (code == KEY_S) || (code == KEY_A) || (code == KEY_D), view = false;
+    char *dbug[DBG_LAST] = {[DBG_NONE] = "off", [DBG_WIRE] = "wireframe",
+                            [DBG_OVER] = "overdraw, red at 8 layers, yellow at 32, white at 128",
+                            [DBG_PART] = "part colors",
+                            [DBG_DENS] = "triangle corners per pixel, red at 8, yellow at 32, white at 128"};
+    long size = 0;
+
+    if ((code == KEY_F1) && down && !engc->keys[code]) {
+        for (long iter = 0; iter < engc->cprt; iter++)
+            size += engc->prng[iter].size;
+        printf("%ld of %ld parts in view, %ld of them occluded, %ld of %ld triangles drawn in %ld calls\n",
+               engc->cvis, engc->cprt, engc->cocc, engc->cdix / 3, size / 3, engc->cdrw);
+    }
+    if ((code == KEY_F2) && down && !engc->keys[code])
+        LatencyReport(engc);
+    if ((code >= KEY_F3) && (code < KEY_F3 + DBG_LAST - DBG_WIRE) && down && !engc->keys[code]) {
+        engc->dbug = (engc->dbug == code - KEY_F3 + DBG_WIRE) ? DBG_NONE : code - KEY_F3 + DBG_WIRE;
+        printf("debug view: %s\n", dbug[engc->dbug]);
+        view = true;
+    }
+    retn = (retn && (!engc->keys[code] != !down)) || view;
     engc->keys[code] = down;
+    if (retn && !engc->tinp)
+        engc->tinp = time;
+    return retn;
 }
 
 
 
-void cResizeWindow(ENGC *engc, long xdim, long ydim) {
+bool cResizeWindow(ENGC *engc, long xdim, long ydim) {
     GLfloat maty = DEF_ZNEA * tanf(0.5 * DEF_FFOV * VEC_DTOR),
             matx = maty * (GLfloat)xdim / (GLfloat)ydim;
 
@@ -133,82 +832,916 @@ void cResizeWindow(ENGC *engc, long xdim, long ydim) {
                    engc->view->prev->curr, engc->proj->curr);
 
     glViewport(0, 0, xdim, ydim);
+    return true;
+}
+
+
+
+/// the camera as scripts see it: position, then yaw and pitch in radians
+void cGetCamera(ENGC *engc, float ftrn[3], float fang[2]) {
+    for (long iter = 0; iter < 3; iter++)
+        ftrn[iter] = engc->ftrn.v[iter];
+    fang[0] = engc->fang.x;
+    fang[1] = engc->fang.y;
+}
+
+void cSetCamera(ENGC *engc, float ftrn[3], float fang[2]) {
+    for (long iter = 0; iter < 3; iter++)
+        engc->fprv.v[iter] = engc->ftrn.v[iter] = ftrn[iter];
+    engc->fang.x = fang[0];
+    engc->fang.y = fang[1];
 }
 
 
 
+/// reads back what results have come, never waiting for the rest
+void OcclusionPoll(ENGC *engc) {
+    GLuint rslt;
+
+    for (long iter = 0; iter < engc->cprt; iter++) {
+        OCCL *occl = &engc->occl[iter];
+
+        for (; occl->ored < occl->odrw; occl->ored++) {
+            glGetQueryObjectuiv(occl->oqry[occl->ored % DEF_OFRM], GL_QUERY_RESULT_AVAILABLE, &rslt);
+            if (!rslt)
+                break;
+            glGetQueryObjectuiv(occl->oqry[occl->ored % DEF_OFRM], GL_QUERY_RESULT, &rslt);
+            occl->ovis = rslt;
+        }
+    }
+}
+
+/// a box that has the eye in it can be clipped away by the near plane
+bool OcclusionInside(PRNG *prng, VEC_T3FV *feye) {
+    for (long iter = 0; iter < 3; iter++)
+        if ((feye->v[iter] < prng->bmin.v[iter] - DEF_OMRG)
+        ||  (feye->v[iter] > prng->bmax.v[iter] + DEF_OMRG))
+            return false;
+    return true;
+}
+
+/// a part drawn on the condition of its query is only drawn if the GPU
+/// finds its box visible, so its indices are not counted as drawn
+void DrawRange(ENGC *engc, GLint offs, GLsizei size, long part, OCCL *occl) {
+    if (!size)
+        return;
+    glUniform1i(engc->uprt, part);
+    glUniform1i(engc->upbs, offs / 3);
+    if (occl)
+        glBeginConditionalRender(occl->oqry[(occl->odrw - 1) % DEF_OFRM], GL_QUERY_WAIT);
+    DrawMesh(engc->mesh, offs, size);
+    if (occl)
+        glEndConditionalRender();
+    else
+        engc->cdix += size;
+    engc->cdrw++;
+}
+
+/// the parts hidden in the last frame get their bounding boxes checked
+/// against the depth of what has been drawn, and are drawn conditionally
+void DrawHidden(ENGC *engc) {
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+    glUseProgram(engc->oprg);
+    glUniformMatrix4fv(engc->omvp, 1, GL_FALSE, engc->view->curr);
+    glBindVertexArray(engc->ovao);
+    for (long iter = 0; iter < engc->cprt; iter++) {
+        OCCL *occl = &engc->occl[iter];
+        PRNG *prng = &engc->prng[iter];
+
+        if (!(occl->ocnd = occl->ohid && (occl->odrw - occl->ored < DEF_OFRM)))
+            continue;
+        glUniform3fv(engc->obmn, 1, prng->bmin.v);
+        glUniform3fv(engc->obmx, 1, prng->bmax.v);
+        glBeginQuery(engc->otyp, occl->oqry[occl->odrw++ % DEF_OFRM]);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 14);
+        glEndQuery(engc->otyp);
+    }
+    glBindVertexArray(0);
+    glDepthMask(GL_TRUE);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    if ((engc->dbug == DBG_WIRE) || (engc->dbug == DBG_DENS))
+        glPolygonMode(GL_FRONT_AND_BACK, (engc->dbug == DBG_WIRE) ? GL_LINE : GL_POINT);
+
+    /// a part whose queries are all still on their way is just drawn
+    glUseProgram(engc->prog);
+    for (long iter = 0; iter < engc->cprt; iter++)
+        if (engc->occl[iter].ohid)
+            DrawRange(engc, engc->prng[iter].offs, engc->prng[iter].size, iter,
+                     (engc->occl[iter].ocnd) ? &engc->occl[iter] : 0);
+}
+
+/// the camera is drawn as far between its last two steps as the time now
+/// is past the last one, so frames that come between two updates still
+/// see it move
 void cRedrawWindow(ENGC *engc) {
+    uint64_t tbgn = rTimeNow();
+    GLfloat step = (engc->tlst) ? (GLfloat)((int64_t)(tbgn - engc->tlst + engc->tacc)) / DEF_STEP : 1.0;
+    LFRM *lfrm;
     VEC_TMFV rmtx, tmtx, mmtx;
+    VEC_T4FV fpln[6];
+    VEC_T3FV ftrn, feye;
+    GLint offs = 0;
+    GLsizei size = 0;
+    long part = 0;
 
     if (!engc->proj)
         return;
 
-    VEC_M4Translate(tmtx, engc->ftrn.x, engc->ftrn.y, engc->ftrn.z);
+    PRF_BGN(zone);
+#ifdef PRF_ZONES
+    GPUZones(engc, false);
+    if ((engc->gcur = engc->ltim && (engc->gdrw - engc->gred < DEF_LFRM))) {
+        engc->gbgn[engc->gdrw % DEF_LFRM] = zone;
+        glBeginQuery(GL_TIME_ELAPSED, engc->gqry[engc->gdrw % DEF_LFRM]);
+    }
+#endif
+    step = (step < 0.0) ? 0.0 : (step > 1.0) ? 1.0 : step;
+    for (long iter = 0; iter < 3; iter++)
+        ftrn.v[iter] = engc->fprv.v[iter] + (engc->ftrn.v[iter] - engc->fprv.v[iter]) * step;
+    VEC_M4Translate(tmtx, ftrn.x, ftrn.y, ftrn.z);
     VEC_M4RotOrts(rmtx, engc->fang.y, engc->fang.x, 0.0);
     VEC_M4Multiply(rmtx, tmtx, mmtx);
     VEC_M4Multiply(engc->proj->curr, mmtx, engc->view->curr);
 
+    /// a frame whose slot still waits for the GPU is just not timed
+    lfrm = &engc->lfrm[engc->ldrw % DEF_LFRM];
+    if ((engc->lcur = engc->ltim && !lfrm->busy))
+        glQueryCounter(lfrm->tqry[0], GL_TIMESTAMP);
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-//    glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    OGL_DrawVBO(engc->fvbo, 0, 0);
+    /// the counting views add fragments up regardless of depth, so they
+    /// show all that gets rasterized, not just what ends up on screen;
+    /// the corner count is the points of every triangle drawn one by one
+    if ((engc->dbug == DBG_OVER) || (engc->dbug == DBG_DENS)) {
+        glDisable(GL_DEPTH_TEST);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glEnable(GL_BLEND);
+    }
+    if ((engc->dbug == DBG_WIRE) || (engc->dbug == DBG_DENS))
+        glPolygonMode(GL_FRONT_AND_BACK, (engc->dbug == DBG_WIRE) ? GL_LINE : GL_POINT);
+    glUseProgram(engc->prog);
+    glUniformMatrix4fv(engc->umvp, 1, GL_FALSE, engc->view->curr);
+    glUniform3f(engc->uftr, ftrn.x, ftrn.y, ftrn.z);
+    glUniform1i(engc->udbg, (engc->dbug == DBG_OVER) || (engc->dbug == DBG_DENS) ? 1 : (engc->dbug == DBG_PART) ? 2 : 0);
+    for (long iter = 0; iter < TBO_LAST; iter++) {
+        glActiveTexture(GL_TEXTURE0 + iter);
+        glBindTexture(GL_TEXTURE_BUFFER, engc->ttex[iter]);
+    }
+
+    /// parts are packed in order, so adjacent visible ones make one draw,
+    /// unless the shader decodes them and needs to be told which is which;
+    /// with occlusion culling, those hidden in the last frame are left for
+    /// later, and every DEF_OVIS frames a visible one is drawn on its own,
+    /// within a query that tells if it still is
+    FrustumPlanes(engc->view->curr, fpln);
+    for (long iter = 0; iter < 3; iter++)
+        feye.v[iter] = -ftrn.v[iter];
+    if (engc->occl)
+        OcclusionPoll(engc);
+    engc->cvis = engc->cdrw = engc->cdix = engc->cocc = 0;
+    for (long iter = 0; iter < engc->cprt; iter++) {
+        PRNG *prng = &engc->prng[iter];
+        OCCL *occl = (engc->occl) ? &engc->occl[iter] : 0;
+
+        if (occl)
+            occl->ohid = false;
+        if (!prng->size || !PartVisible(prng, fpln))
+            continue;
+        engc->cvis++;
+        if (occl) {
+            if (!occl->ovis && OcclusionInside(prng, &feye))
+                occl->ovis = true;
+            if (!occl->ovis) {
+                occl->ohid = true;
+                engc->cocc++;
+                continue;
+            }
+            if (((engc->ofrm + iter) % DEF_OVIS == 0) && (occl->odrw - occl->ored < DEF_OFRM)) {
+                DrawRange(engc, offs, size, part, 0);
+                size = 0;
+                glBeginQuery(engc->otyp, occl->oqry[occl->odrw++ % DEF_OFRM]);
+                DrawRange(engc, prng->offs, prng->size, iter, 0);
+                glEndQuery(engc->otyp);
+                continue;
+            }
+        }
+        if ((prng->offs != offs + size) || (engc->uprt >= 0)) {
+            DrawRange(engc, offs, size, part, 0);
+            offs = prng->offs;
+            size = 0;
+            part = iter;
+        }
+        size += prng->size;
+    }
+    DrawRange(engc, offs, size, part, 0);
+    if (engc->occl && engc->cocc)
+        DrawHidden(engc);
+    engc->ofrm++;
+    for (long iter = TBO_LAST - 1; iter >= 0; iter--) {
+        glActiveTexture(GL_TEXTURE0 + iter);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+    }
+    glUseProgram(0);
+    glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    glDisable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+
+    /// the input this frame is the first to show is now drawn, not shown
+    if (engc->tinp)
+        LatencyAdd(&engc->lhst[LAT_DRAW], rTimeNow() - engc->tinp);
+    engc->tfrm = engc->tinp;
+    engc->tinp = 0;
+    if (engc->lcur) {
+        glQueryCounter(lfrm->tqry[1], GL_TIMESTAMP);
+        lfrm->tinp = engc->tfrm;
+        lfrm->busy = true;
+    }
+#ifdef PRF_ZONES
+    if (engc->gcur) {
+        glEndQuery(GL_TIME_ELAPSED);
+        engc->gdrw++;
+    }
+#endif
+    MetricsPut(engc, tbgn);
+    PRF_END(zone, "cRedrawWindow");
+}
+
+
+
+/// to be called right after the front end swaps buffers
+void cSwapDone(ENGC *engc) {
+    if (engc->tfrm)
+        LatencyAdd(&engc->lhst[LAT_SWAP], rTimeNow() - engc->tfrm);
+    engc->tfrm = 0;
+    engc->ldrw += engc->lcur;
+    engc->lcur = false;
+    LatencyPoll(engc, false);
+}
+
+
+
+/// starts serving metrics on a Unix socket at path, replacing a stale
+/// socket if there is one there, and refusing anything else that is;
+/// every connection gets a snapshot and is closed
+bool cServeStats(ENGC *engc, char *path) {
+#ifdef _WIN32
+    return false;
+#else
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    struct stat fsta;
+
+    if (engc->mpth || (strlen(path) >= sizeof(addr.sun_path)))
+        return false;
+    if (!lstat(path, &fsta)) {
+        if (!S_ISSOCK(fsta.st_mode))
+            return false;
+        unlink(path);
+    }
+    strcpy(addr.sun_path, path);
+    if ((engc->msck = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        return false;
+    if (bind(engc->msck, (struct sockaddr*)&addr, sizeof(addr)) || listen(engc->msck, 8)) {
+        close(engc->msck);
+        return false;
+    }
+    engc->mpub = engc->msta;
+    engc->mpth = strdup(path);
+    if (pthread_create(&engc->mthr, 0, MetricsFunc, engc)) {
+        close(engc->msck);
+        unlink(engc->mpth);
+        free(engc->mpth);
+        engc->mpth = 0;
+        return false;
+    }
+    return true;
+#endif
+}
+
+
+
+/// FNV-1a, only eating 8 bytes at a time; good enough to tell files apart
+uint64_t rHashData(char *data, long size) {
+    uint64_t retn = 0xCBF29CE484222325ULL, word;
+    long iter;
+
+    for (iter = 0; iter + 8 <= size; iter += 8) {
+        memcpy(&word, data + iter, sizeof(word));
+        retn = (retn ^ word) * 0x100000001B3ULL;
+    }
+    for (; iter < size; iter++)
+        retn = (retn ^ (uint8_t)data[iter]) * 0x100000001B3ULL;
+    return retn ^ (retn >> 32);
+}
+
+/// the cache entry for a model is a byte-exact image of what ImportWL3()
+/// hands over to the GPU, tied to the exact contents of its source file
+bool rCacheKey(CKEY *ckey, char *name) {
+    struct stat fsta;
+    FMAP fmap;
+
+    if (stat(name, &fsta) || !rMapFile(&fmap, name))
+        return false;
+    ckey->flen = fmap.flen;
+    ckey->mtim = fsta.st_mtime;
+    ckey->hash = rHashData(fmap.fptr, fmap.flen);
+    rFreeFile(&fmap);
+    return true;
+}
+
+/// $XDG_CACHE_HOME/wcn/, ~/.cache/wcn/ or %LOCALAPPDATA%\wcn\, named after
+/// the hash of the full source path, as realpath() or _fullpath() makes it
+/// of whatever was typed; the directories get created on demand
+char *rCachePath(char *name, char **full) {
+    char *retn, *fdir, *hdir, *sdir;
+    long size;
+
+#ifdef _WIN32
+    *full = _fullpath(0, name, 0);
+    hdir = getenv("LOCALAPPDATA");
+    fdir = (hdir) ? strdup(hdir) : 0;
+    sdir = "\\wcn";
+#else
+    *full = realpath(name, 0);
+    if ((hdir = getenv("XDG_CACHE_HOME")) && *hdir)
+        fdir = strdup(hdir);
+    else if ((hdir = getenv("HOME")) && *hdir) {
+        fdir = malloc(strlen(hdir) + sizeof("/.cache"));
+        sprintf(fdir, "%s/.cache", hdir);
+    }
+    else
+        fdir = 0;
+    sdir = "/wcn";
+#endif
+    if (!fdir || !*full) {
+        free(*full);
+        free(fdir);
+        return *full = 0;
+    }
+    size = strlen(fdir) + strlen(sdir) + 1 + 16 + sizeof(DEF_CEXT);
+    retn = malloc(size);
+    sprintf(retn, "%s%s", fdir, sdir);
+#ifdef _WIN32
+    CreateDirectoryA(retn, 0);
+#else
+    mkdir(fdir, 0755);
+    mkdir(retn, 0755);
+#endif
+    sprintf(retn + strlen(retn), "%c%016llX" DEF_CEXT, sdir[0],
+           (unsigned long long)rHashData(*full, strlen(*full)));
+    free(fdir);
+    return retn;
+}
+
+/// on success the streams point right into the mapped cache entry, which
+/// is to be released with rFreeFile() once the streams are no longer needed
+bool rLoadCache(FMAP *fmap, char *name, CKEY *ckey, OGL_UNIF *uvbo, long cvbo) {
+    char *path, *full;
+    CCHH *cchh;
+    CCHS *cchs;
+    long iter;
+
+    if (!(path = rCachePath(name, &full)))
+        return false;
+    iter = rMapFile(fmap, path);
+    free(path);
+    if (!iter) {
+        free(full);
+        return false;
+    }
+    cchh = (void*)fmap->fptr;
+    cchs = (void*)(cchh + 1);
+    iter = (fmap->flen >= sizeof(*cchh))
+        && (cchh->magc == DEF_CMAG) && (cchh->vers == DEF_CVER) && (cchh->cvbo == cvbo)
+        && (cchh->flen == ckey->flen) && (cchh->mtim == ckey->mtim) && (cchh->hash == ckey->hash)
+        && (fmap->flen >= sizeof(*cchh) + cvbo * sizeof(*cchs) + cchh->plen)
+        && (cchh->plen == strlen(full) + 1)
+        && !memcmp(cchs + cvbo, full, cchh->plen);
+    for (long indx = 0; iter && (indx < cvbo); indx++)
+        iter = (cchs[indx].offs <= fmap->flen) && (cchs[indx].cdat <= fmap->flen - cchs[indx].offs);
+    free(full);
+    if (!iter) {
+        rFreeFile(fmap);
+        return false;
+    }
+    for (iter = 0; iter < cvbo; iter++) {
+        uvbo[iter].type = cchs[iter].type;
+        uvbo[iter].cdat = cchs[iter].cdat;
+        uvbo[iter].pdat = fmap->fptr + cchs[iter].offs;
+    }
+    return true;
 }
 
+/// written aside and renamed into place, so that viewers running at the
+/// same time never see a half-written entry; failing here is not an error
+void rSaveCache(char *name, CKEY *ckey, OGL_UNIF *uvbo, long cvbo) {
+    char *path, *temp, *full, zero[DEF_CALN] = {};
+    CCHS *cchs;
+    CCHH cchh;
+    FILE *file;
+    long offs;
 
+    if (!(path = rCachePath(name, &full)))
+        return;
+    temp = malloc(strlen(path) + 32);
+    sprintf(temp, "%s.%ld", path, (long)getpid());
+    if ((file = fopen(temp, "wb"))) {
+        cchh = (CCHH){DEF_CMAG, DEF_CVER, ckey->flen, ckey->mtim, ckey->hash, strlen(full) + 1, cvbo};
+        cchs = calloc(cvbo, sizeof(*cchs));
+        offs = sizeof(cchh) + cvbo * sizeof(*cchs) + cchh.plen;
+        for (long iter = 0; iter < cvbo; iter++) {
+            offs = (offs + DEF_CALN - 1) & -DEF_CALN;
+            cchs[iter] = (CCHS){uvbo[iter].type, uvbo[iter].cdat, offs};
+            offs += uvbo[iter].cdat;
+        }
+        offs = (fwrite(&cchh, sizeof(cchh), 1, file) == 1)
+            && (fwrite(cchs, sizeof(*cchs), cvbo, file) == cvbo)
+            && (fwrite(full, 1, cchh.plen, file) == cchh.plen);
+        for (long iter = 0, fpad; offs && (iter < cvbo); iter++)
+            offs = ((fpad = cchs[iter].offs - ftell(file)) >= 0)
+                && (fwrite(zero, 1, fpad, file) == fpad)
+                && (fwrite(uvbo[iter].pdat, 1, uvbo[iter].cdat, file) == uvbo[iter].cdat);
+        free(cchs);
+#ifdef _WIN32
+        if (fclose(file) || !offs || !MoveFileExA(temp, path, MOVEFILE_REPLACE_EXISTING))
+#else
+        if (fclose(file) || !offs || rename(temp, path))
+#endif
+            remove(temp);
+    }
+    free(temp);
+    free(path);
+    free(full);
+}
 
-char *rLoadFile(char *name, long *size) {
-    char *retn = 0;
-    long file, flen;
+VEC_T3FV ReadI32T3F(uint32_t *vec) {
+    float scale = 0.5 / I32_SWAP(vec[0]);
+    return (VEC_T3FV){{ scale * I32_SWAP(vec[1]),
+                       -scale * I32_SWAP(vec[2]),
+                       -scale * I32_SWAP(vec[3])}};
+}
+
+typedef struct {
+    PBLK pblk;      /** the part`s blocks, see rPartBlocks()   **/
+    long cind;      /** index of the part`s first corner       **/
+    long cvtx;      /** unique vertices left after welding     **/
+    long vind;      /** index of the part`s first vertex       **/
+    long tind;      /** index of the part`s first triangle idx **/
+    long ctri;      /** triangles left after triangulation     **/
+    long mbef;      /** vertex cache misses before reordering  **/
+    long maft;      /** vertex cache misses after reordering   **/
+    PRNG prng;      /** bounds, and the draw range when packed **/
+} PDSC;
+
+/// bulk big-endian decoders: plain C versions first, then SSE4.1 and AVX2
+/// ones that must give the very same bits
+typedef struct {
+    /// dst[i] = src[i] >> 1
+    void (*Idx16)(GLuint *dst, uint16_t *src, long size);
+    /// dst[i] = src[i]
+    void (*Swp16)(uint16_t *dst, uint16_t *src, long size);
+} KERN;
+
+void Idx16(GLuint *dst, uint16_t *src, long size) {
+    for (long iter = 0; iter < size; iter++)
+        dst[iter] = U16_SWAP(src[iter]) >> 1;
+}
+
+void Swp16(uint16_t *dst, uint16_t *src, long size) {
+    for (long iter = 0; iter < size; iter++)
+        dst[iter] = U16_SWAP(src[iter]);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SSE_BSWAP16 _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+
+__attribute__((target("sse4.1")))
+void Idx16_SSE(GLuint *dst, uint16_t *src, long size) {
+    long iter;
+
+    for (iter = 0; iter + 8 <= size; iter += 8) {
+        __m128i vsrc = _mm_loadu_si128((__m128i*)(src + iter));
+        vsrc = _mm_srli_epi16(_mm_shuffle_epi8(vsrc, SSE_BSWAP16), 1);
+        _mm_storeu_si128((__m128i*)(dst + iter + 0), _mm_cvtepu16_epi32(vsrc));
+        _mm_storeu_si128((__m128i*)(dst + iter + 4), _mm_cvtepu16_epi32(_mm_srli_si128(vsrc, 8)));
+    }
+    Idx16(dst + iter, src + iter, size - iter);
+}
+
+__attribute__((target("sse4.1")))
+void Swp16_SSE(uint16_t *dst, uint16_t *src, long size) {
+    long iter;
+
+    for (iter = 0; iter + 8 <= size; iter += 8) {
+        __m128i vsrc = _mm_loadu_si128((__m128i*)(src + iter));
+        _mm_storeu_si128((__m128i*)(dst + iter), _mm_shuffle_epi8(vsrc, SSE_BSWAP16));
+    }
+    Swp16(dst + iter, src + iter, size - iter);
+}
+
+__attribute__((target("avx2")))
+void Idx16_AVX(GLuint *dst, uint16_t *src, long size) {
+    long iter;
+
+    for (iter = 0; iter + 16 <= size; iter += 16) {
+        __m256i vsrc = _mm256_loadu_si256((__m256i*)(src + iter));
+        vsrc = _mm256_srli_epi16(_mm256_shuffle_epi8(vsrc, _mm256_broadcastsi128_si256(SSE_BSWAP16)), 1);
+        _mm256_storeu_si256((__m256i*)(dst + iter + 0), _mm256_cvtepu16_epi32(_mm256_castsi256_si128(vsrc)));
+        _mm256_storeu_si256((__m256i*)(dst + iter + 8), _mm256_cvtepu16_epi32(_mm256_extracti128_si256(vsrc, 1)));
+    }
+    Idx16_SSE(dst + iter, src + iter, size - iter);
+}
+
+__attribute__((target("avx2")))
+void Swp16_AVX(uint16_t *dst, uint16_t *src, long size) {
+    long iter;
+
+    for (iter = 0; iter + 16 <= size; iter += 16) {
+        __m256i vsrc = _mm256_loadu_si256((__m256i*)(src + iter));
+        vsrc = _mm256_shuffle_epi8(vsrc, _mm256_broadcastsi128_si256(SSE_BSWAP16));
+        _mm256_storeu_si256((__m256i*)(dst + iter), vsrc);
+    }
+    Swp16_SSE(dst + iter, src + iter, size - iter);
+}
 
-    if ((file = open(name, O_RDONLY)) > 0) {
-        flen = lseek(file, 0, SEEK_END);
-        lseek(file, 0, SEEK_SET);
-        retn = malloc(flen + 1);
-        if (read(file, retn, flen) == flen) {
-            retn[flen] = '\0';
-            if (size)
-                *size = flen;
+#undef SSE_BSWAP16
+#endif
+
+KERN *GetKernels(void) {
+    static KERN kern[] = {{Idx16, Swp16},
+#if defined(__x86_64__) || defined(__i386__)
+                          {Idx16_SSE, Swp16_SSE},
+                          {Idx16_AVX, Swp16_AVX},
+#endif
+    };
+    static long kind = -1;
+
+    if (kind < 0) {
+        kind = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        uint32_t eax, ebx, ecx, edx, xcr0 = 0;
+
+        if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_1)) {
+            kind = 1;
+            /// AVX2 also needs the OS to preserve YMM registers, see XCR0
+            if ((ecx & bit_OSXSAVE) && (ecx & bit_AVX)) {
+                __asm__("xgetbv" : "=a"(xcr0), "=d"(edx) : "c"(0));
+                if (((xcr0 & 6) == 6) && __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2))
+                    kind = 2;
+            }
         }
-        else {
-            free(retn);
-            retn = 0;
+#endif
+    }
+    return &kern[kind];
+}
+
+/// the only thing that ties the parts together is where each one starts in
+/// the corner arrays, and that is just a prefix sum over the prim counts
+PDSC *ScanParts(char *file, long *cprt) {
+    long cind, tind;
+    PDSC *retn;
+
+    rPartAt(file, 0, cprt);
+    retn = calloc(*cprt + 1, sizeof(*retn));
+    cind = tind = 0;
+    for (long iter = 0; iter < *cprt; iter++) {
+        PDSC *pdsc = &retn[iter];
+
+        rPartBlocks(&pdsc->pblk, file, iter);
+        pdsc->cind = cind;
+        pdsc->tind = tind;
+        cind += (pdsc->pblk.tri + pdsc->pblk.qua) * 4;
+        tind += (pdsc->pblk.tri + pdsc->pblk.qua * 2) * 3;
+    }
+    retn[*cprt].cind = cind;
+    retn[*cprt].tind = tind;
+    return retn;
+}
+
+/// merges the corners of a part that match in every attribute, packing
+/// the unique ones to the start of the part`s range and making the indices
+/// point there; since N corners never yield more than N vertices, the Nth
+/// corner is always consumed before anything gets written over it
+void WeldPart(OGL_UNIF *uvbo, PDSC *pdsc) {
+    GLuint *ibuf = (GLuint*)uvbo[0].pdat + pdsc->cind, *hash;
+    VPOS *vbuf = (VPOS*)uvbo[1].pdat + pdsc->cind;
+    long hmsk, size = (pdsc->pblk.tri + pdsc->pblk.qua) * 4;
+
+    for (hmsk = 1; hmsk < size * 2; hmsk <<= 1);
+    hash = malloc(hmsk * sizeof(*hash));
+    memset(hash, 0xFF, hmsk-- * sizeof(*hash));
+    pdsc->cvtx = 0;
+    for (long iter = 0; iter < size; iter++) {
+        VPOS ckey = vbuf[iter];
+        for (long hpos = rHashData((char*)&ckey, sizeof(ckey)) & hmsk;; hpos = (hpos + 1) & hmsk) {
+            if (hash[hpos] == ~0U) {
+                vbuf[pdsc->cvtx] = ckey;
+                ibuf[iter] = hash[hpos] = pdsc->cvtx++;
+                break;
+            }
+            if (!memcmp(&vbuf[hash[hpos]], &ckey, sizeof(ckey))) {
+                ibuf[iter] = hash[hpos];
+                break;
+            }
+        }
+    }
+    free(hash);
+}
+
+/// the same transform the vertex shader applies to compact positions
+VEC_T3FV PartVertex(VPOS *vpos, VEC_T4FV *ofsc) {
+    return (VEC_T3FV){{( 1.f / 0x7FFF * vpos->x + ofsc->x) * ofsc->w,
+                       (-1.f / 0x7FFF * vpos->y + ofsc->y) * ofsc->w,
+                       (-1.f / 0x7FFF * vpos->z + ofsc->z) * ofsc->w}};
+}
+
+/// the sphere is centered on the box, but is then shrunk to the farthest
+/// vertex, which for elongated parts is a good deal tighter than the box
+void BoundPart(OGL_UNIF *uvbo, PDSC *pdsc) {
+    VPOS *vpos = (VPOS*)uvbo[1].pdat + pdsc->cind;
+    PRNG *prng = &pdsc->prng;
+    VEC_T3FV *vbuf;
+    GLfloat dist;
+
+    *prng = (PRNG){.ofsc = prng->ofsc};
+    if (!pdsc->cvtx)
+        return;
+    vbuf = malloc(pdsc->cvtx * sizeof(*vbuf));
+    for (long iter = 0; iter < pdsc->cvtx; iter++)
+        vbuf[iter] = PartVertex(&vpos[iter], &prng->ofsc);
+    prng->bmin = prng->bmax = PartVertex(vpos, &prng->ofsc);
+    for (long iter = 1; iter < pdsc->cvtx; iter++)
+        for (long indx = 0; indx < 3; indx++) {
+            prng->bmin.v[indx] = fminf(prng->bmin.v[indx], vbuf[iter].v[indx]);
+            prng->bmax.v[indx] = fmaxf(prng->bmax.v[indx], vbuf[iter].v[indx]);
         }
-        close(file);
+    for (long indx = 0; indx < 3; indx++)
+        prng->cntr.v[indx] = 0.5 * (prng->bmin.v[indx] + prng->bmax.v[indx]);
+    for (long iter = 0; iter < pdsc->cvtx; iter++) {
+        dist = (vbuf[iter].x - prng->cntr.x) * (vbuf[iter].x - prng->cntr.x)
+             + (vbuf[iter].y - prng->cntr.y) * (vbuf[iter].y - prng->cntr.y)
+             + (vbuf[iter].z - prng->cntr.z) * (vbuf[iter].z - prng->cntr.z);
+        prng->rads = fmaxf(prng->rads, dist);
     }
+    prng->rads = sqrtf(prng->rads);
+    free(vbuf);
+}
+
+/// a FIFO cache of DEF_ACSZ entries, with the number of misses so far used
+/// as the clock: a vertex is still cached if it missed DEF_ACSZ ticks ago
+long CacheMisses(GLuint *tind, long size, long cvtx) {
+    long *tick = malloc(cvtx * sizeof(*tick)), retn = 0;
+
+    for (long iter = 0; iter < cvtx; iter++)
+        tick[iter] = -DEF_ACSZ;
+    for (long iter = 0; iter < size; iter++)
+        if (retn - tick[tind[iter]] >= DEF_ACSZ)
+            tick[tind[iter]] = retn++;
+    free(tick);
     return retn;
 }
 
-#define I16_SWAP(v) ((int16_t)(((uint16_t)(v) >> 8) | ((uint16_t)(v) << 8)))
-#define U16_SWAP(v) ((uint16_t)I16_SWAP(v))
-#define I32_SWAP(v) ((int32_t)(U16_SWAP((uint32_t)(v) >> 16) | (U16_SWAP(v) << 16)))
-#define U32_SWAP(v) ((uint32_t)I32_SWAP(v))
+float VertexScore(long cpos, long tcnt) {
+    float retn;
+
+    if (!tcnt)
+        return -1.f;
+    if (cpos < 0)
+        retn = 0.f;
+    else if (cpos < 3)
+        retn = 0.75f;
+    else
+        retn = powf(1.f - (float)(cpos - 3) / (DEF_VCSZ - 3), 1.5f);
+    return retn + 2.f / sqrtf(tcnt);
+}
 
-VEC_T3FV ReadI32T3F(VEC_T4IV *vec) {
-    float scale = 0.5 / I32_SWAP(vec->x);
-    return (VEC_T3FV){{ scale * I32_SWAP(vec->y),
-                       -scale * I32_SWAP(vec->z),
-                       -scale * I32_SWAP(vec->w)}};
+/// Tom Forsyth`s linear-speed vertex cache optimization: greedily emits the
+/// triangle whose vertices are the most recently used and the least shared;
+/// tpri[] holds a value per triangle, which is reordered along with them
+void OrderTris(GLuint *tind, GLuint *tpri, long ctri, long cvtx) {
+    long *tcnt = calloc(cvtx, sizeof(*tcnt)), *toff = calloc(cvtx + 1, sizeof(*toff)),
+         *tadj = malloc(ctri * 3 * sizeof(*tadj)), *cpos = malloc(cvtx * sizeof(*cpos));
+    long cach[DEF_VCSZ + 3], ncch[DEF_VCSZ + 3], ccnt = 0, ncnt, best = -1, next = 0;
+    float *vscr = malloc(cvtx * sizeof(*vscr)), *tscr = malloc(ctri * sizeof(*tscr)), bscr;
+    GLuint *retn = malloc(ctri * 4 * sizeof(*retn)), *retp = retn + ctri * 3;
+    char *done = calloc(ctri, sizeof(*done));
+
+    for (long iter = 0; iter < ctri * 3; iter++)
+        toff[tind[iter] + 1]++;
+    for (long iter = 0; iter < cvtx; iter++)
+        toff[iter + 1] += toff[iter];
+    for (long iter = 0; iter < ctri * 3; iter++)
+        tadj[toff[tind[iter]] + tcnt[tind[iter]]++] = iter / 3;
+    for (long iter = 0; iter < cvtx; iter++)
+        vscr[iter] = VertexScore(cpos[iter] = -1, tcnt[iter]);
+    for (long iter = bscr = 0; iter < ctri; iter++)
+        if ((tscr[iter] = vscr[tind[iter * 3]] + vscr[tind[iter * 3 + 1]] + vscr[tind[iter * 3 + 2]]) > bscr)
+            bscr = tscr[best = iter];
+
+    for (long oind = 0; oind < ctri; oind++) {
+        /// nothing cached is left to continue with, start anew
+        if (best < 0) {
+            while (done[next])
+                next++;
+            best = next;
+        }
+        memcpy(&retn[oind * 3], &tind[best * 3], 3 * sizeof(*retn));
+        retp[oind] = tpri[best];
+        done[best] = 1;
+
+        ncnt = 0;
+        for (long indx = 0; indx < 3; indx++) {
+            long vert = tind[best * 3 + indx], *tlst = &tadj[toff[vert]];
+
+            for (long iter = 0; iter < tcnt[vert]; iter++)
+                if (tlst[iter] == best) {
+                    tlst[iter] = tlst[--tcnt[vert]];
+                    break;
+                }
+            ncch[ncnt++] = vert;
+        }
+        for (long iter = 0; iter < ccnt; iter++)
+            if ((cach[iter] != ncch[0]) && (cach[iter] != ncch[1]) && (cach[iter] != ncch[2]))
+                ncch[ncnt++] = cach[iter];
+
+        /// the ones pushed out of the cache need rescoring just as well
+        for (long iter = 0; iter < ncnt; iter++) {
+            cpos[ncch[iter]] = (iter < DEF_VCSZ) ? iter : -1;
+            vscr[ncch[iter]] = VertexScore(cpos[ncch[iter]], tcnt[ncch[iter]]);
+        }
+        ccnt = (ncnt < DEF_VCSZ) ? ncnt : DEF_VCSZ;
+        memcpy(cach, ncch, ccnt * sizeof(*cach));
+
+        best = -1;
+        bscr = -1.f;
+        for (long iter = 0; iter < ncnt; iter++)
+            for (long indx = 0; indx < tcnt[ncch[iter]]; indx++) {
+                long trio = tadj[toff[ncch[iter]] + indx];
+
+                tscr[trio] = vscr[tind[trio * 3]] + vscr[tind[trio * 3 + 1]] + vscr[tind[trio * 3 + 2]];
+                if ((iter < ccnt) && (tscr[trio] > bscr))
+                    bscr = tscr[best = trio];
+            }
+    }
+    memcpy(tind, retn, ctri * 3 * sizeof(*tind));
+    memcpy(tpri, retp, ctri * sizeof(*tpri));
+    free(done);
+    free(retn);
+    free(tscr);
+    free(vscr);
+    free(cpos);
+    free(tadj);
+    free(toff);
+    free(tcnt);
 }
 
-VEC_T3FV ReadI16T3F(char *pos) {
-    return (VEC_T3FV){{ 1.f / 0x7FFF * I16_SWAP(((int16_t*)pos)[0]),
-                       -1.f / 0x7FFF * I16_SWAP(((int16_t*)pos)[1]),
-                       -1.f / 0x7FFF * I16_SWAP(((int16_t*)pos)[2])}};
+/// splits quads along the A-C diagonal, drops the triangles that welding
+/// has made degenerate, then reorders the rest for post-transform caching;
+/// tpri[] gets the index of the prim each triangle came from
+void TrianglePart(OGL_UNIF *uvbo, PDSC *pdsc, GLuint *tind, GLuint *tpri) {
+    GLuint *ibuf = (GLuint*)uvbo[0].pdat + pdsc->cind, *tbuf = tind + pdsc->tind, *pbuf = tpri + pdsc->tind / 3;
+
+    pdsc->ctri = 0;
+    for (long iter = 0; iter < pdsc->pblk.tri + pdsc->pblk.qua; iter++) {
+        GLuint *quad = &ibuf[iter * 4], trio[2][3] = {{quad[0], quad[1], quad[2]}, {quad[0], quad[2], quad[3]}};
+
+        for (long indx = 0; indx < 2; indx++)
+            if ((trio[indx][0] != trio[indx][1]) && (trio[indx][1] != trio[indx][2])
+            &&  (trio[indx][2] != trio[indx][0])) {
+                pbuf[pdsc->ctri] = pdsc->cind / 4 + iter;
+                memcpy(&tbuf[pdsc->ctri++ * 3], trio[indx], sizeof(*trio));
+            }
+    }
+    pdsc->mbef = CacheMisses(tbuf, pdsc->ctri * 3, pdsc->cvtx);
+    OrderTris(tbuf, pbuf, pdsc->ctri, pdsc->cvtx);
+    pdsc->maft = CacheMisses(tbuf, pdsc->ctri * 3, pdsc->cvtx);
+}
+
+/// moves the vertices and triangles of all parts next to each other, in
+/// order, rebasing the indices; tind & tpri get those of the whole model
+void PackParts(OGL_UNIF *uvbo, GLuint *tind, GLuint *tpri, PDSC *pdsc, long cprt, long *cvtx, long *cind) {
+    *cvtx = *cind = 0;
+    for (long iter = 0; iter < cprt; iter++) {
+        memmove((VPOS*)uvbo[1].pdat + *cvtx, (VPOS*)uvbo[1].pdat + pdsc[iter].cind, pdsc[iter].cvtx * sizeof(VPOS));
+        for (long indx = 0; indx < pdsc[iter].cvtx; indx++)
+            ((VPOS*)uvbo[1].pdat)[*cvtx + indx].p = iter;
+        memmove(tind + *cind, tind + pdsc[iter].tind, pdsc[iter].ctri * 3 * sizeof(*tind));
+        memmove(tpri + *cind / 3, tpri + pdsc[iter].tind / 3, pdsc[iter].ctri * sizeof(*tpri));
+        for (long indx = 0; indx < pdsc[iter].ctri * 3; indx++)
+            tind[*cind + indx] += *cvtx;
+        pdsc[iter].vind = *cvtx;
+        pdsc[iter].tind = *cind;
+        pdsc[iter].prng.offs = *cind;
+        pdsc[iter].prng.size = pdsc[iter].ctri * 3;
+        *cvtx += pdsc[iter].cvtx;
+        *cind += pdsc[iter].ctri * 3;
+    }
 }
 
-VEC_T3FV ReadI8T3F(char *pos) {
-    return (VEC_T3FV){{ 1.f / 0x7F * ((int8_t*)pos)[0],
-                       -1.f / 0x7F * ((int8_t*)pos)[1],
-                       -1.f / 0x7F * ((int8_t*)pos)[2]}};
+/// indices: triangles first, then quads; swapping triangles to the upper
+/// 3/4 and spreading downwards never overwrites anything not yet spread:
+/// the Nth triangle is read from [tri + N * 3]
+void DecodeIndices(OGL_UNIF *uvbo, PDSC *pdsc, KERN *kern) {
+    GLuint *ibuf = (GLuint*)uvbo[0].pdat + pdsc->cind;
+    long tri = pdsc->pblk.tri;
+
+    kern->Idx16(ibuf + tri, pdsc->pblk.tidx, tri * 3);
+    for (long iter = 0; iter < tri; iter++) {
+        GLuint ind0 = ibuf[tri + iter * 3 + 0], ind1 = ibuf[tri + iter * 3 + 1], ind2 = ibuf[tri + iter * 3 + 2];
+        ibuf[iter * 4 + 0] = ind0;
+        ibuf[iter * 4 + 1] = ind1;
+        ibuf[iter * 4 + 2] = ind2;
+        ibuf[iter * 4 + 3] = ind2;
+    }
+    kern->Idx16(ibuf + tri * 4, pdsc->pblk.qidx, pdsc->pblk.qua * 4);
 }
 
-void PutTag(long bgn, long len, uint32_t fclr, uint32_t nclr, char *name) {
-    static long id = 0;
-    printf("    <TAG id=\"%ld\">\n      <start_offset>%ld</start_offset>\n      <end_offset>%ld</end_offset>\n"
-           "      <tag_text>%s</tag_text>\n      <font_colour>#%06X</font_colour>\n"
-           "      <note_colour>#%06X</note_colour>\n    </TAG>\n", id++, bgn, bgn + len - 1, name, fclr, nclr);
+/// indices past the vertex count read on into the file, as they always
+/// did; swapping everything up to the highest index keeps the gather free
+/// of range checks. Every vertex is swapped once and then copied to the
+/// corners using it; the part index gets filled in on packing
+void DecodeVertices(OGL_UNIF *uvbo, PDSC *pdsc, KERN *kern) {
+    PBLK *pblk = &pdsc->pblk;
+    GLuint *ibuf = (GLuint*)uvbo[0].pdat + pdsc->cind, imax = 0;
+    VPOS *vbuf = (VPOS*)uvbo[1].pdat + pdsc->cind;
+    long ccrn = (pblk->tri + pblk->qua) * 4, vmax = pblk->nvtx;
+    VEC_T3FV plus = ReadI32T3F(pblk->part->offset);
+    int16_t *vtmp;
+
+    pdsc->prng.ofsc = (VEC_T4FV){{plus.x, plus.y, plus.z, (float)I32_SWAP(pblk->part->offset[0]) / 0x7FFFF}};
+    for (long iter = 0; iter < ccrn; iter++)
+        imax = (ibuf[iter] > imax) ? ibuf[iter] : imax;
+    if (ccrn && (imax >= vmax))
+        vmax = imax + 1;
+    vtmp = malloc(vmax * 3 * sizeof(*vtmp));
+    kern->Swp16((uint16_t*)vtmp, (uint16_t*)pblk->vert, vmax * 3);
+    for (long iter = 0; iter < ccrn; iter++)
+        vbuf[iter] = (VPOS){vtmp[ibuf[iter] * 3 + 0], vtmp[ibuf[iter] * 3 + 1], vtmp[ibuf[iter] * 3 + 2], 0};
+    free(vtmp);
 }
 
-void ImportWL3(OGL_UNIF *uvbo, char *name, bool xmlOnly) {
+void DecodeNormals(OGL_UNIF *uvbo, PDSC *pdsc, KERN *kern) {
+    VPRM *pbuf = (VPRM*)uvbo[2].pdat + pdsc->cind / 4;
+    int8_t *pnrm = pdsc->pblk.pnrm;
+
+    for (long iter = 0; iter < pdsc->pblk.tri + pdsc->pblk.qua; iter++) {
+        pbuf[iter].x = pnrm[iter * 3 + 0];
+        pbuf[iter].y = pnrm[iter * 3 + 1];
+        pbuf[iter].z = pnrm[iter * 3 + 2];
+    }
+}
+
+void DecodeColors(OGL_UNIF *uvbo, PDSC *pdsc, KERN *kern) {
+    VPRM *pbuf = (VPRM*)uvbo[2].pdat + pdsc->cind / 4;
+
+    for (long iter = 0; iter < pdsc->pblk.tri + pdsc->pblk.qua; iter++)
+        pbuf[iter].c = U16_SWAP(pdsc->pblk.attr[iter]);
+}
+
+/// the stages of decoding a part, in the order of BCH_* and in the order
+/// they have to run in: vertices are gathered by the indices decoded
+void (*DecodeStage[BCH_LAST])(OGL_UNIF*, PDSC*, KERN*) =
+    {DecodeIndices, DecodeVertices, DecodeNormals, DecodeColors};
+#ifdef PRF_ZONES
+char *DecodeZone[BCH_LAST] =
+    {"DecodeIndices", "DecodeVertices", "DecodeNormals", "DecodeColors"};
+#endif
+
+/// parts do not share a single corner, so any number of them can be
+/// decoded at once; the blocks are located beforehand, which leaves every
+/// stage a straight pass over its block
+void DecodePart(OGL_UNIF *uvbo, PDSC *pdsc, KERN *kern) {
+    for (long iter = 0; iter < BCH_LAST; iter++) {
+        PRF_BGN(zone);
+        DecodeStage[iter](uvbo, pdsc, kern);
+        PRF_END(zone, DecodeZone[iter]);
+    }
+}
+
+typedef struct {
+    OGL_UNIF *uvbo;
+    GLuint *tind, *tpri;
+    PDSC *pdsc;
+    KERN *kern;
+} DDAT;
+
+void DecodeFunc(void *user, long indx) {
+    DDAT *ddat = user;
+
+    DecodePart(ddat->uvbo, &ddat->pdsc[indx], ddat->kern);
+    PRF_BGN(weld);
+    WeldPart(ddat->uvbo, &ddat->pdsc[indx]);
+    PRF_END(weld, "WeldPart");
+    PRF_BGN(bound);
+    BoundPart(ddat->uvbo, &ddat->pdsc[indx]);
+    PRF_END(bound, "BoundPart");
+    PRF_BGN(order);
+    TrianglePart(ddat->uvbo, &ddat->pdsc[indx], ddat->tind, ddat->tpri);
+    PRF_END(order, "TrianglePart");
+}
+
+void ImportWL3(OGL_UNIF *uvbo, char *name) {
 // Common values for 'name':
 
 // "r4back01/r4back01.wl3"  // level 1 (the dump), part 1
@@ -288,265 +1821,268 @@ void ImportWL3(OGL_UNIF *uvbo, char *name, bool xmlOnly) {
 // "camera/camera.wl3"      // EMPTY (???)
 // "wirecam/wirecam.wl3"    // some camera asset, never seen in-game
 
-    #pragma pack(push, 1)
-    struct WL3H {           // Main Header
-        uint32_t offsPart;  // offset of the Part Table
-        uint32_t offsUnk;   // offset to some (W,W,D,D,D,D) block of unknown purpose
-        uint32_t offsColi;  // the game refers to this value as 'offset to colitab', purpose unknown
-        uint32_t offsTail;  // offset to some array at the very end of the file
-
-        uint32_t numPart;   // size of the Part Table
-
-        uint32_t numVert;   // total vertex count
-        uint32_t numPrim;   // total primitive count
-
-        uint32_t unk1[9];   // UNKNOWN
-        uint32_t unk2[3];   // UNKNOWN
-
-        uint8_t name[16];   // name of the model
-        uint16_t hdrSize;   // remaining header size
-        uint16_t hdrObjs;   // remaining header object count
-    } *wl3h;
-    struct PART {           // Part Table
-        uint32_t pidx;      // offset: prim indices
-        uint32_t vert;      // offset: vertices
-        uint32_t texc;      // offset: texture coords
-        uint32_t pnrm;      // offset: per-prim normals
-        uint32_t vnrm;      // offset: per-vertex normals
-        uint32_t attr;      // offset: prim attributes
-
-        uint32_t numVert;   // vertex count for this part
-        uint32_t numPrim;   // primitive count for this part
-
-        uint32_t unk1[2];   // UNKNOWN
-
-        VEC_T4IV offset;    // offsets: [scale, X, Y, Z]
-
-        uint32_t unk2[3];   // UNKNOWN, probably a vector
-        uint32_t unk3;      // UNKNOWN
-
-        uint16_t always0C;  // theoretically should be the size of unk6, but seems to be fixed
-        uint16_t unk5;      // UNKNOWN
-        uint32_t unk6[3];   // UNKNOWN, [2] gets initialized with '-2'
-
-        uint8_t tex[12];    // texture ID
-
-        uint16_t partSize;  // remaining part size
-        uint16_t partObjs;  // remaining part object count
-    } *part;
-    #pragma pack(pop)
-
-    char *fptr, *file = rLoadFile(name, 0);
-    long cind = 0;
-
+    KERN *kern = GetKernels();
+    char *file;
+    long cprt, ccrn, cvtx, cind, mbef = 0, maft = 0;
+    VPRM *tprm;
+    DDAT ddat;
+    PDSC *pdsc;
+    FMAP fmap;
+
+    /// the file is parsed in place and never written to
+    PRF_BGN(zone);
+    PRF_BGN(load);
+    file = (rMapFile(&fmap, name)) ? fmap.fptr : 0;
+    PRF_END(load, "rMapFile");
     if (!file) {
         printf("'%s': cannot load the file! Exiting.\n", name);
         exit(2);
     }
 
-    if (xmlOnly)
-        printf("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<wxHexEditor_XML_TAG>\n  <filename path=\"%s\">\n", name);
-
-    wl3h = (void*)file;
-
     uvbo[0].type = 0;
-    uvbo[1].type = OGL_UNI_T3FV;
-    uvbo[2].type = OGL_UNI_T3FV;
-    uvbo[3].type = OGL_UNI_T3FV;
-    uvbo[0].pdat = calloc(1, uvbo[0].cdat = U32_SWAP(wl3h->numPrim) * 4 * sizeof(GLuint));
-    uvbo[1].pdat = calloc(1, uvbo[1].cdat = U32_SWAP(wl3h->numPrim) * 4 * sizeof(VEC_T3FV));
-    uvbo[2].pdat = calloc(1, uvbo[2].cdat = U32_SWAP(wl3h->numPrim) * 4 * sizeof(VEC_T3FV));
-    uvbo[3].pdat = calloc(1, uvbo[3].cdat = U32_SWAP(wl3h->numPrim) * 4 * sizeof(VEC_T3FV));
-
-    if (xmlOnly) {
-        PutTag((char*)&wl3h->offsPart - file, 4, 0x000000, 0x55C6C3, "part table offset");
-        PutTag((char*)&wl3h->offsUnk - file, 4, 0x000000, 0x906000, "unknown struct offset");
-        PutTag((char*)&wl3h->offsColi - file, 4, 0x000000, 0xF03030, "colitab offset");
-        PutTag((char*)&wl3h->offsTail - file, 4, 0x000000, 0x9A1490, "tail offset");
-        PutTag((char*)&wl3h->numPart - file, 4, 0x000000, 0x55C6C3, "part table size");
-        PutTag((char*)&wl3h->numVert - file, 4, 0x000000, 0x204A87, "total vertex count");
-        PutTag((char*)&wl3h->numPrim - file, 4, 0x000000, 0xCF5C00, "total prim count");
-        PutTag((char*)&wl3h->name - file, 16, 0x000000, 0x5ED505, "name");
-
-        PutTag((char*)&wl3h->hdrSize - file, 2, 0x000000, 0xEFD43B, "header size");
-        PutTag((char*)&wl3h->hdrSize - file + 2, 2, 0x000000, 0xEFD43B, "header objs");
-        PutTag((char*)&wl3h->hdrSize - file + 4, U16_SWAP(wl3h->hdrSize), 0x000000, 0xEFD43B, "header");
-
-        fptr = (char*)file + U32_SWAP(wl3h->offsUnk);
-        for (long iter = 0, size = (fptr != file) ? U32_SWAP(wl3h->numPart) * 2 - 1 : 0; iter < size; iter++) {
-            PutTag(fptr - file + iter * 20, 20, 0x000000, (iter & 1) ? 0x906000 : 0xF0C070, "");
-        }
+    uvbo[1].type = 0;
+    uvbo[2].type = 0;
+    uvbo[3].type = 0;
+    /// sized by what the parts really hold, and not by wl3h->numPrim;
+    /// uvbo[2] is per prim until the triangles are known
+    PRF_BGN(scan);
+    pdsc = ScanParts(file, &cprt);
+    PRF_END(scan, "ScanParts");
+    ccrn = pdsc[cprt].cind;
+    uvbo[0].pdat = calloc(1, uvbo[0].cdat = ccrn * sizeof(GLuint));
+    uvbo[1].pdat = calloc(1, uvbo[1].cdat = ccrn * sizeof(VPOS));
+    uvbo[2].pdat = calloc(1, uvbo[2].cdat = ccrn / 4 * sizeof(VPRM));
+    ddat = (DDAT){uvbo, malloc(pdsc[cprt].tind * sizeof(GLuint)), malloc(pdsc[cprt].tind / 3 * sizeof(GLuint)),
+                  pdsc, kern};
+
+    PRF_BGN(part);
+    rParallelFor(cprt, DecodeFunc, &ddat);
+    PRF_END(part, "DecodeFunc");
+    PRF_BGN(pack);
+    PackParts(uvbo, ddat.tind, ddat.tpri, pdsc, cprt, &cvtx, &cind);
+    PRF_END(pack, "PackParts");
+    uvbo[3].pdat = malloc(uvbo[3].cdat = cprt * sizeof(PRNG));
+    for (long iter = 0; iter < cprt; iter++) {
+        ((PRNG*)uvbo[3].pdat)[iter] = pdsc[iter].prng;
+        mbef += pdsc[iter].mbef;
+        maft += pdsc[iter].maft;
     }
+    free(pdsc);
 
-    fptr = (char*)file + U32_SWAP(wl3h->offsColi);
-    if ((fptr != file) && xmlOnly)
-        PutTag(fptr - file, 2, 0x000000, 0xF03030, "colitab");
-
-    fptr = (char*)file + U32_SWAP(wl3h->offsTail) + 2;
-    if (xmlOnly) {
-        PutTag(fptr - file - 2, 2, 0x000000, 0x9A1490, "tail size");
-        PutTag(fptr - file, U16_SWAP(((uint16_t*)fptr)[-1]) * 2, 0x000000, 0x9A1490, "tail");
-    }
-
-    // at the Part Table offset there`s a vector prepended by its total byte size that contains offsets to Part Tables
-    // (except the last one - it comes directly after the said vector)
-    for (long offs = U32_SWAP(wl3h->offsPart), size = U32_SWAP(*(uint32_t*)(file + offs)), iter = 4;
-         iter <= size; iter += 4) {
-        if ((iter == 4) && xmlOnly)
-            PutTag(offs, size, 0x000000, 0x55C6C3, "part table");
-        part = (void*)(file + offs + ((iter == size) ? size : U32_SWAP(*(uint32_t*)(file + offs + iter))));
-
-        if (xmlOnly) {
-            PutTag((char*)part - file +   0, 4, 0x0000FF, 0x9070E0, "part: prim indices");
-            PutTag((char*)part - file +   4, 4, 0x000000, 0x9070E0, "part: vertices");
-            PutTag((char*)part - file +   8, 4, 0x000000, 0x9070E0, "part: texcoords");
-            PutTag((char*)part - file +  12, 4, 0x000000, 0x9070E0, "part: prim normals");
-            PutTag((char*)part - file +  16, 4, 0x000000, 0x9070E0, "part: vertex normals");
-            PutTag((char*)part - file +  20, 4, 0x000000, 0x9070E0, "part: prim attrs");
-            PutTag((char*)part - file +  24, 4, 0x000000, 0x204A87, "part: vertex count");
-            PutTag((char*)part - file +  28, 4, 0x000000, 0xCF5C00, "part: prim count");
-            PutTag((char*)part - file +  32, 4 * 3, 0x000000, 0x41F356, "part: (D,D, part scale)");
-            PutTag((char*)part - file +  44, 4 * 3, 0x000000, 0x41F356, "part: offsets (X,Y,Z)");
-            PutTag((char*)part - file +  56, 4 * 3, 0x000000, 0x41F356, "part: (D,D,D)");
-            PutTag((char*)part - file +  68, 4, 0x000000, 0x557C2A, "part: (usually 0) (?)");
-            PutTag((char*)part - file +  72, 16, 0x000000, 0x557C2A, "part: (W,W,D,D,D)");
-            PutTag((char*)part - file +  88, 12, 0x000000, 0x9070E0, "part: texture");
-            PutTag((char*)part - file + 100, 2, 0x000000, 0x901090, "part: tail size");
-            PutTag((char*)part - file + 102, 2, 0x000000, 0x901090, "part: tail objs");
-        }
-
-        /// indices: triangles
-
-        fptr = (char*)part + U32_SWAP(part->pidx) + 2;
+    free(uvbo[0].pdat);
+    uvbo[0].pdat = realloc(ddat.tind, uvbo[0].cdat = cind * sizeof(GLuint));
+    uvbo[1].pdat = realloc(uvbo[1].pdat, uvbo[1].cdat = cvtx * sizeof(VPOS));
+    tprm = malloc(cind / 3 * sizeof(*tprm));
+    for (long iter = 0; iter < cind / 3; iter++)
+        tprm[iter] = ((VPRM*)uvbo[2].pdat)[ddat.tpri[iter]];
+    free(uvbo[2].pdat);
+    free(ddat.tpri);
+    uvbo[2].pdat = tprm;
+    uvbo[2].cdat = cind / 3 * sizeof(*tprm);
 
-        if (xmlOnly)
-            PutTag(fptr - file - 2, 2, 0x0000FF, 0xFCAF3E, "triangle count");
+    printf("'%s': %ld corners welded into %ld vertices, %ld bytes of VRAM saved\n",
+           name, ccrn, cvtx, (ccrn - cvtx) * (long)sizeof(VPOS));
+    printf("'%s': %ld triangles, ACMR %.3f before reordering, %.3f after\n",
+           name, cind / 3, (cind) ? 3.0 * mbef / cind : 0.0, (cind) ? 3.0 * maft / cind : 0.0);
 
-        long tri = U16_SWAP(((uint16_t*)fptr)[-1]);
-        for (long iter = 0; iter < tri; iter++) {
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 0] = (U16_SWAP(((uint16_t*)fptr)[iter * 3 + 0]) >> 1);
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 1] = (U16_SWAP(((uint16_t*)fptr)[iter * 3 + 1]) >> 1);
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 2] = (U16_SWAP(((uint16_t*)fptr)[iter * 3 + 2]) >> 1);
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 3] = (U16_SWAP(((uint16_t*)fptr)[iter * 3 + 2]) >> 1);
-            if (xmlOnly)
-                PutTag(fptr - file + iter * 6, 6, 0x000000, (iter & 1) ? 0xFCAF3E : 0xCF5C00, "");
-        }
-        cind += tri * 4;
-        fptr += tri * 6 + 2;
-
-        /// indices: quads
-
-        if (xmlOnly)
-            PutTag(fptr - file - 2, 2, 0x000000, (tri & 1) ? 0xFCAF3E : 0xCF5C00, "quad count");
-
-        long qua = U16_SWAP(((uint16_t*)fptr)[-1]);
-        for (long iter = 0; iter < qua; iter++) {
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 0] = (U16_SWAP(((uint16_t*)fptr)[iter * 4 + 0]) >> 1);
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 1] = (U16_SWAP(((uint16_t*)fptr)[iter * 4 + 1]) >> 1);
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 2] = (U16_SWAP(((uint16_t*)fptr)[iter * 4 + 2]) >> 1);
-            ((GLuint*)uvbo[0].pdat)[cind + iter * 4 + 3] = (U16_SWAP(((uint16_t*)fptr)[iter * 4 + 3]) >> 1);
-            if (xmlOnly)
-                PutTag(fptr - file + iter * 8, 8, 0x000000, ((tri + iter) & 1) ? 0xCF5C00 : 0xFCAF3E, "");
-        }
-        cind += qua * 4;
+    rFreeFile(&fmap);
+    PRF_END(zone, "ImportWL3");
+}
 
-        long vert = U32_SWAP(part->numVert), prim = U32_SWAP(part->numPrim);
 
-        /// vertices
 
-        fptr = (char*)part + U32_SWAP(part->vert);
-        VEC_T3FV plus = ReadI32T3F(&part->offset);
-        float scale = (float)I32_SWAP(part->offset.x) / 0x7FFFF;
-        for (long iter = 0; iter < prim; iter++) {
-            for (long indx = 0; indx < 4; indx++) {
-                VEC_T3FV *base = ((VEC_T3FV*)uvbo[1].pdat) + cind - prim * 4 + iter * 4 + indx;
-                *base = ReadI16T3F(fptr + ((GLuint*)uvbo[0].pdat)[cind - prim * 4 + iter * 4 + indx] * 3 * 2);
-                VEC_V3AddV(base, &plus);
-                VEC_V3MulC(base, scale);
-            }
-        }
-        for (long iter = (xmlOnly) ? 0 : vert; iter < vert; iter++)
-            PutTag(fptr - file + iter * 6, 6, (iter) ? 0x000000 : 0x0000FF, (iter & 1) ? 0x204A87 : 0x729FCF, "");
+/// runs every stage of the CPU decoder over all the parts, reps times in a
+/// row on the calling thread; time[] and size[] get the nanoseconds each
+/// of the BCH_LAST stages took and the bytes of the file it read per run;
+/// returns the prim count, or -1 if the file cannot be loaded
+long cBenchDecode(char *name, long reps, uint64_t *time, uint64_t *size) {
+    OGL_UNIF uvbo[3] = {};
+    KERN *kern = GetKernels();
+    long cprt, cprm = 0;
+    uint64_t tbgn;
+    PDSC *pdsc;
+    FMAP fmap;
+
+    if (!rMapFile(&fmap, name))
+        return -1;
+    pdsc = ScanParts(fmap.fptr, &cprt);
+    uvbo[0].pdat = malloc(pdsc[cprt].cind * sizeof(GLuint));
+    uvbo[1].pdat = malloc(pdsc[cprt].cind * sizeof(VPOS));
+    uvbo[2].pdat = malloc(pdsc[cprt].cind / 4 * sizeof(VPRM));
+    memset(size, 0, BCH_LAST * sizeof(*size));
+    for (long iter = 0; iter < cprt; iter++) {
+        PBLK *pblk = &pdsc[iter].pblk;
+
+        cprm += pblk->tri + pblk->qua;
+        size[BCH_INDX] += (pblk->tri * 3 + pblk->qua * 4 + 2) * sizeof(uint16_t);
+        size[BCH_VERT] += pblk->nvtx * 3 * sizeof(int16_t);
+        size[BCH_NORM] += (pblk->tri + pblk->qua) * 3 * sizeof(int8_t);
+        size[BCH_CLRS] += (pblk->tri + pblk->qua) * sizeof(uint16_t);
+    }
+    for (long stag = 0; stag < BCH_LAST; stag++) {
+        tbgn = rTimeNow();
+        for (long iter = 0; iter < reps; iter++)
+            for (long indx = 0; indx < cprt; indx++)
+                DecodeStage[stag](uvbo, &pdsc[indx], kern);
+        time[stag] = rTimeNow() - tbgn;
+    }
+    for (long iter = 0; iter < 3; iter++)
+        free(uvbo[iter].pdat);
+    free(pdsc);
+    rFreeFile(&fmap);
+    return cprm;
+}
 
-        /// texcoords
 
-        fptr = (char*)part + U32_SWAP(part->texc) + 2;
-        if (xmlOnly)
-            PutTag(fptr - file - 2, 2, 0x0000FF, 0xFCAF3E, "texcoord count, never used");
-        for (long iter = 0; iter < prim; iter++) {
-            if (xmlOnly)
-                PutTag(fptr - file + iter * 4, 4, 0x000000, (iter & 1) ? 0xFCAF3E : 0xCF5C00, "");
-        }
 
-        /// prim normals
-
-        fptr = (char*)part + U32_SWAP(part->pnrm);
-        for (long iter = 0; iter < prim; iter++) {
-            VEC_T3FV *base = ((VEC_T3FV*)uvbo[2].pdat) + cind - prim * 4 + iter * 4;
-            VEC_T3FV norm = ReadI8T3F(fptr + iter * 3);
-            VEC_V3MulC(&norm, -1.f);
-            VEC_V3Normalize(&norm);
-            base[0] = base[1] = base[2] = base[3] = norm;
-            if (xmlOnly)
-                PutTag(fptr - file + iter * 3, 3, (iter) ? 0x000000 : 0x0000FF, (iter & 1) ? 0x204A87 : 0x729FCF, "");
-        }
+/// leaves the decoding to the vertex shader: the file goes to the GPU as is,
+/// with the offsets of each part`s blocks and its prim counts, 2 texels per
+/// part; the bounds come from the extremes of the raw positions, and each
+/// part gets drawn as 3 vertices per triangle and 6 per quad
+void ImportRaw(OGL_UNIF *uvbo, FMAP *fmap, char *name) {
+    VEC_T4IV *desc;
+    PRNG *prng;
+    PDSC *pdsc;
+    long cprt;
 
-        /// vertex normals
-
-        fptr = (char*)part + U32_SWAP(part->vnrm);
-        for (long iter = 0; iter < tri; iter++) {
-            if (xmlOnly) {
-                PutTag(fptr - file + iter * 3 * 3 + 0, 3,
-                      (iter * 3 + 0) ? 0x000000 : 0x0000FF, ((iter * 3 + 0) & 1) ? 0x204A87 : 0x729FCF, "");
-                PutTag(fptr - file + iter * 3 * 3 + 3, 3,
-                      (iter * 3 + 1) ? 0x000000 : 0x0000FF, ((iter * 3 + 1) & 1) ? 0x204A87 : 0x729FCF, "");
-                PutTag(fptr - file + iter * 3 * 3 + 6, 3,
-                      (iter * 3 + 2) ? 0x000000 : 0x0000FF, ((iter * 3 + 2) & 1) ? 0x204A87 : 0x729FCF, "");
-            }
-        }
-        fptr += tri * 3 * 3;
-        for (long iter = 0; iter < qua; iter++) {
-            if (xmlOnly) {
-                PutTag(fptr - file + iter * 4 * 3 + 0, 3, 0x000000, ((iter * 4 + 0) & 1) ? 0x204A87 : 0x729FCF, "");
-                PutTag(fptr - file + iter * 4 * 3 + 3, 3, 0x000000, ((iter * 4 + 1) & 1) ? 0x204A87 : 0x729FCF, "");
-                PutTag(fptr - file + iter * 4 * 3 + 6, 3, 0x000000, ((iter * 4 + 2) & 1) ? 0x204A87 : 0x729FCF, "");
-                PutTag(fptr - file + iter * 4 * 3 + 9, 3, 0x000000, ((iter * 4 + 3) & 1) ? 0x204A87 : 0x729FCF, "");
-            }
+    if (!rMapFile(fmap, name)) {
+        printf("'%s': cannot load the file! Exiting.\n", name);
+        exit(2);
+    }
+    pdsc = ScanParts(fmap->fptr, &cprt);
+    uvbo[0].pdat = fmap->fptr;
+    uvbo[0].cdat = fmap->flen;
+    uvbo[1].pdat = desc = calloc(1, uvbo[1].cdat = cprt * 2 * sizeof(*desc));
+    uvbo[2].pdat = prng = calloc(1, uvbo[2].cdat = cprt * sizeof(*prng));
+    for (long iter = 0; iter < cprt; iter++) {
+        PBLK *pblk = &pdsc[iter].pblk;
+        struct PART *part = pblk->part;
+        long offs = (char*)part - fmap->fptr, vert = pblk->nvtx;
+        int16_t *vraw = pblk->vert;
+        VPOS vmin = {0x7FFF, 0x7FFF, 0x7FFF}, vmax = {-0x8000, -0x8000, -0x8000};
+        VEC_T3FV plus = ReadI32T3F(part->offset), bmin, bmax;
+
+        desc[iter * 2 + 0] = (VEC_T4IV){{offs + U32_SWAP(part->pidx), offs + U32_SWAP(part->vert),
+                                         offs + U32_SWAP(part->pnrm), offs + U32_SWAP(part->attr)}};
+        desc[iter * 2 + 1] = (VEC_T4IV){{pblk->tri, pblk->qua}};
+        prng[iter].ofsc = (VEC_T4FV){{plus.x, plus.y, plus.z, (float)I32_SWAP(part->offset[0]) / 0x7FFFF}};
+        prng[iter].size = (pblk->tri + pblk->qua * 2) * 3;
+        if (!vert)
+            continue;
+        for (long indx = 0; indx < vert; indx++) {
+            VPOS vpos = {I16_SWAP(vraw[indx * 3 + 0]), I16_SWAP(vraw[indx * 3 + 1]), I16_SWAP(vraw[indx * 3 + 2])};
+            vmin = (VPOS){(vpos.x < vmin.x) ? vpos.x : vmin.x, (vpos.y < vmin.y) ? vpos.y : vmin.y,
+                          (vpos.z < vmin.z) ? vpos.z : vmin.z};
+            vmax = (VPOS){(vpos.x > vmax.x) ? vpos.x : vmax.x, (vpos.y > vmax.y) ? vpos.y : vmax.y,
+                          (vpos.z > vmax.z) ? vpos.z : vmax.z};
         }
-
-        /// prim attributes
-
-        fptr = (char*)part + U32_SWAP(part->attr);
-        for (long iter = 0; iter < prim; iter++) {
-            uint16_t clr = U16_SWAP(((uint16_t*)fptr)[iter]);
-            ((VEC_T3FV*)uvbo[3].pdat)[((GLuint*)uvbo[0].pdat)[cind + (iter - prim) * 4 + 3]] = (VEC_T3FV){{
-                1.f / 0x1F * ((clr >> 10) & 0x1F), 1.f / 0x1F * ((clr >> 5) & 0x1F), 1.f / 0x1F * ((clr >> 0) & 0x1F)
-            }};
-            if (xmlOnly)
-                PutTag(fptr - file + iter * 2, 2, (iter) ? 0x000000 : 0x0000FF, (iter & 1) ? 0xFCAF3E : 0xCF5C00, "");
+        /// Y and Z get negated, so their extremes may swap places
+        bmin = PartVertex(&vmin, &prng[iter].ofsc);
+        bmax = PartVertex(&vmax, &prng[iter].ofsc);
+        for (long indx = 0; indx < 3; indx++) {
+            prng[iter].bmin.v[indx] = fminf(bmin.v[indx], bmax.v[indx]);
+            prng[iter].bmax.v[indx] = fmaxf(bmin.v[indx], bmax.v[indx]);
+            prng[iter].cntr.v[indx] = 0.5 * (bmin.v[indx] + bmax.v[indx]);
+            prng[iter].rads += 0.25 * (bmax.v[indx] - bmin.v[indx]) * (bmax.v[indx] - bmin.v[indx]);
         }
+        prng[iter].rads = sqrtf(prng[iter].rads);
     }
+    free(pdsc);
+}
 
-    for (long iter = 0; iter * sizeof(GLuint) < uvbo[0].cdat; iter++) {
-        ((GLuint*)uvbo[0].pdat)[iter] = iter;
-    }
 
-    if (xmlOnly)
-        printf("  </filename>\n</wxHexEditor_XML_TAG>\n");
 
-    free(file);
+/// reading big-endian values from the file, for the GPU-side decoder
+#define SHD_FILE "uniform usamplerBuffer file;"                   \
+                 "uniform isamplerBuffer pdsc;"                   \
+                 "uniform int part;"                              \
+                                                                  \
+                 "uint U8(int offs) {"                            \
+                     "return texelFetch(file, offs).r;"           \
+                 "}"                                              \
+                 "uint U16(int offs) {"                           \
+                     "return (U8(offs) << 8u) | U8(offs + 1);"    \
+                 "}"                                              \
+                 "int I16(int offs) {"                            \
+                     "return (int(U16(offs)) ^ 0x8000) - 0x8000;" \
+                 "}"                                              \
+                 "int I8(int offs) {"                             \
+                     "return (int(U8(offs)) ^ 0x80) - 0x80;"      \
+                 "}"
+
+/// the pixel shader proper, common to both decoders that only differ in
+/// the way Prim() gets the normal and the color of the current triangle;
+/// dbug = 1 makes every fragment add to a heat ramp, dbug = 2 colors parts
+/// and only shades them a little, so that they can be told apart anywhere
+#define SHD_MAIN "smooth in vec3 v;"                                                               \
+                 "flat in int p;"                                                                  \
+                                                                                                   \
+                 "uniform int dbug;"                                                               \
+                                                                                                   \
+                 "out vec4 fclr;"                                                                  \
+                                                                                                   \
+                 "void main() {"                                                                   \
+                     "const float DEF_ZFAR = " STRINGIFY(DEF_ZFAR) ";"                             \
+                     "const vec3 lightColor = vec3(1.0, 1.0, 1.0);"                                \
+                     "const vec3 ambient = vec3(0.1, 0.1, 0.1);"                                   \
+                     "vec3 clr = vec3(1.0, 1.0, 1.0), n, c;"                                       \
+                     "if (dbug == 1) {"                                                            \
+                         "fclr = vec4(1.0 / 8.0, 1.0 / 32.0, 1.0 / 128.0, 1.0);"                   \
+                         "return;"                                                                 \
+                     "}"                                                                           \
+                     "Prim(n, c);"                                                                 \
+                     "if (dbug == 2) {"                                                            \
+                         "clr = vec3((uvec3(uint(p + 1) * 2654435761u) >> uvec3(8u, 16u, 24u)) & 255u) / 255.0;" \
+                         "fclr = vec4(clr * (0.5 + 0.5 * abs(dot(n, normalize(v)))), 1.0);"        \
+                         "return;"                                                                 \
+                     "}"                                                                           \
+                     "float dist = 1.0 - min(dot(v, v), DEF_ZFAR * DEF_ZFAR) / DEF_ZFAR / DEF_ZFAR;" \
+                     "vec3 diffuse = lightColor * clamp(dot(n, normalize(v)), 0.0, 1.0) * dist;"   \
+                     "fclr = clamp(vec4(clr.rgb * (diffuse + ambient), 1.0), 0.0, 1.0);"           \
+                 "}"
+
+void *GetProc(char *name) {
+#ifdef _WIN32
+    /// some drivers give 1, 2, 3 or -1 instead of 0 for what they lack
+    intptr_t retn = (intptr_t)wglGetProcAddress(name);
+
+    return ((retn >= -1) && (retn <= 3)) ? 0 : (void*)retn;
+#else
+    static void *self;
+
+    if (!self)
+        self = dlopen(0, RTLD_LAZY);
+    return (self) ? dlsym(self, name) : 0;
+#endif
 }
 
+/// the context has to be current already; with anything needed missing
+/// there is no way to draw, so it exits, much like on a file it cannot load
+void LoadGL(void) {
+#define PROC_LOAD(type, name, need) \
+    if (!(p##name = (type)GetProc(#name)) && need) { \
+        printf("Cannot find %s() in the GL library! Exiting.\n", #name); \
+        exit(2); \
+    }
+    GL_PROCS(PROC_LOAD)
+#undef PROC_LOAD
+}
 
-
-ENGC *cMakeEngine(char *name, bool xmlOnly) {
+ENGC *cMakeEngine(char *name, uint32_t flgs) {
+    FMAP cach = {}, fmap = {};
+    GLint tmax, vmaj, vmin;
+    uint64_t timp;
+    CKEY ckey;
+    bool ccok;
     ENGC *retn;
 
+    LoadGL();
     retn = calloc(1, sizeof(*retn));
 
     retn->ftrn.x =  3.4;
     retn->ftrn.y = -3.8;
     retn->ftrn.z = -6.0;
+    retn->fprv = retn->ftrn;
 
     retn->fang.x = 30.00 * VEC_DTOR;
     retn->fang.y = 30.00 * VEC_DTOR;
@@ -559,70 +2095,234 @@ ENGC *cMakeEngine(char *name, bool xmlOnly) {
     glDepthFunc(GL_LESS);
     glEnable(GL_DEPTH_TEST);
 
+    /// timestamp queries are core since 3.3, and an extension before it;
+    /// either way, the library has to have the entry points for them
+    glGetIntegerv(GL_MAJOR_VERSION, &vmaj);
+    glGetIntegerv(GL_MINOR_VERSION, &vmin);
+    retn->ltim = (vmaj > 3) || ((vmaj == 3) && (vmin >= 3));
+    glGetIntegerv(GL_NUM_EXTENSIONS, &tmax);
+    while (!retn->ltim && (--tmax >= 0))
+        retn->ltim = !strcmp((char*)glGetStringi(GL_EXTENSIONS, tmax), "GL_ARB_timer_query");
+    retn->ltim &= glQueryCounter && glGetQueryObjectui64v && glGetInteger64v;
+    for (long iter = 0; retn->ltim && (iter < DEF_LFRM); iter++)
+        glGenQueries(2, retn->lfrm[iter].tqry);
+#ifdef PRF_ZONES
+    if (retn->ltim)
+        glGenQueries(DEF_LFRM, retn->gqry);
+#endif
+
     OGL_UNIF uvbo[] =
         {{/** indices **/ .draw = GL_STATIC_DRAW},
          {.name = "vert", .draw = GL_STATIC_DRAW},
-         {.name = "norm", .draw = GL_STATIC_DRAW},
-         {.name = "clrs", .draw = GL_STATIC_DRAW}};
-
-    OGL_UNIF puni[] =
-        {{.name = "mMVP", .type = OGL_UNI_TMFV, .pdat = &retn->view},
-         {.name = "ftrn", .type = OGL_UNI_T3FV, .pdat = &retn->ftrn}};
-
-    ImportWL3(uvbo, name, xmlOnly);
-    retn->fvbo = OGL_MakeVBO(0, GL_QUADS, sizeof(uvbo) / sizeof(*uvbo), uvbo, sizeof(puni) / sizeof(*puni), puni,
-                             2, (char*[]){
-                                /** === main vertex shader **/
-                                "#version 150\n"
-
-                                "uniform mat4 mMVP;"
-
-                                /** attributes **/
-                                "attribute vec3 vert;"
-                                "attribute vec3 norm;"
-                                "attribute vec3 clrs;"
-
-                                "uniform vec3 ftrn;"
-
-                                "smooth out vec3 v;"
-                                "flat out vec3 n;"
-                                "flat out vec3 c;"
-
-                                "void main() {"
-                                    "v = -ftrn - vert;"
-                                    "n = norm;"
-                                    "c = clrs;"
-                                    "gl_Position = mMVP * vec4(vert, 1.0);"
-                                "}",
-
-                                /** === main pixel shader **/
-                                "#version 150\n"
-
-                                "uniform sampler2D tile;"
-
-                                "smooth in vec3 v;"
-                                "flat in vec3 n;"
-                                "flat in vec3 c;"
-
-                                "void main() {"
-                                    "const float DEF_ZFAR = %s;"
-                                    "const vec3 lightColor = vec3(1.0, 1.0, 1.0);"
-                                    "const vec3 ambient = vec3(0.1, 0.1, 0.1);"
-                                    "vec3 clr = vec3(1.0, 1.0, 1.0);"
-                                    "float dist = 1.0 - min(dot(v, v), DEF_ZFAR * DEF_ZFAR) / DEF_ZFAR / DEF_ZFAR;"
-                                    "vec3 diffuse = lightColor * clamp(dot(n, normalize(v)), 0.0, 1.0) * dist;"
-                                    "gl_FragColor = clamp(vec4(clr.rgb * (diffuse + ambient), 1.0), 0.0, 1.0);"
-                                "}"}, STRINGIFY(DEF_ZFAR));
-
-    free(uvbo[0].pdat);
-    free(uvbo[1].pdat);
-    free(uvbo[2].pdat);
-    free(uvbo[3].pdat);
+         {/** VPRM[] **/},
+         {/** PRNG[] **/}};
+    OGL_UNIF rvbo[] =
+        {{/** the file **/}, {/** VEC_T4IV[] **/}, {/** PRNG[] **/}};
+    VFMT vfmt[] =
+        {{4, GL_SHORT, GL_FALSE, GL_FALSE}};
+    char *smpl[TBO_LAST] = {"ofsc", "file", "pdsc", "prim"};
+    long cvbo = sizeof(uvbo) / sizeof(*uvbo);
+    OGL_UNIF *prng = &uvbo[cvbo - 1];
+    VEC_T4FV *ofsc;
+
+    timp = rTimeNow();
+    if (flgs & ENG_GPUDECODE) {
+        ImportRaw(rvbo, &fmap, name);
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &tmax);
+        if (rvbo[0].cdat > tmax) {
+            printf("'%s': %ld bytes do not fit a buffer texture, decoding on the CPU\n", name, (long)rvbo[0].cdat);
+            free(rvbo[1].pdat);
+            free(rvbo[2].pdat);
+            rFreeFile(&fmap);
+            flgs &= ~ENG_GPUDECODE;
+        }
+    }
+    if (flgs & ENG_GPUDECODE) {
+        printf("'%s': %ld parts, %ld bytes uploaded to be decoded on the GPU\n",
+               name, (long)(rvbo[2].cdat / sizeof(PRNG)), (long)rvbo[0].cdat);
+        prng = &rvbo[2];
+        /// no attributes at all, but core profile still needs a VAO to draw
+        retn->mesh = MakeMesh(uvbo, vfmt, 1);
+        retn->ttex[TBO_FILE] = MakeTBuf(GL_R8UI, rvbo[0].pdat, rvbo[0].cdat, &retn->tbuf[TBO_FILE]);
+        retn->ttex[TBO_PDSC] = MakeTBuf(GL_RGBA32I, rvbo[1].pdat, rvbo[1].cdat, &retn->tbuf[TBO_PDSC]);
+        retn->msta.vram = retn->mesh->vram + rvbo[0].cdat + rvbo[1].cdat;
+    }
+    else {
+        ccok = rCacheKey(&ckey, name);
+        PRF_BGN(load);
+        if (ccok)
+            rLoadCache(&cach, name, &ckey, uvbo, cvbo);
+        PRF_END(load, "rLoadCache");
+        if (!cach.fptr) {
+            ImportWL3(uvbo, name);
+            PRF_BGN(save);
+            if (ccok)
+                rSaveCache(name, &ckey, uvbo, cvbo);
+            PRF_END(save, "rSaveCache");
+        }
+        retn->mesh = MakeMesh(uvbo, vfmt, 2);
+        retn->ttex[TBO_PRIM] = MakeTBuf(GL_RGBA16I, uvbo[2].pdat, uvbo[2].cdat, &retn->tbuf[TBO_PRIM]);
+        retn->msta.vram = retn->mesh->vram + uvbo[2].cdat;
+    }
+    retn->msta.timp = rTimeNow() - timp;
+
+    if (flgs & ENG_GPUDECODE)
+        retn->prog = MakeProgram(/** === raw vertex shader: pulls everything
+                                     from the file by itself **/
+                                 "#version 150 core\n"
+
+                                 "uniform mat4 mMVP;"
+                                 "uniform samplerBuffer ofsc;"
+                                 SHD_FILE
+
+                                 "uniform vec3 ftrn;"
+
+                                 "smooth out vec3 v;"
+                                 "flat out int p;"
+
+                                 "void main() {"
+                                     "ivec4 offs = texelFetch(pdsc, part * 2), cnts = texelFetch(pdsc, part * 2 + 1);"
+                                     "int indx;"
+                                     "if (gl_VertexID < cnts.x * 3)"
+                                         "indx = offs.x + 2 + gl_VertexID * 2;"
+                                     "else {"
+                                         /// quads are split as ABC + ACD
+                                         "int quad = gl_VertexID - cnts.x * 3, crnr = quad % 6;"
+                                         "crnr = (crnr < 3) ? crnr : (crnr == 3) ? 0 : crnr - 2;"
+                                         "indx = offs.x + 2 + cnts.x * 6 + 2 + (quad / 6 * 4 + crnr) * 2;"
+                                     "}"
+                                     "indx = offs.y + int(U16(indx) >> 1u) * 6;"
+                                     "vec4 pofs = texelFetch(ofsc, part);"
+                                     "vec3 vpos = (vec3(I16(indx), -I16(indx + 2), -I16(indx + 4)) / 32767.0 + pofs.xyz) * pofs.w;"
+                                     "v = -ftrn - vpos;"
+                                     "p = part;"
+                                     "gl_Position = mMVP * vec4(vpos, 1.0);"
+                                 "}",
+
+                                 /** === raw pixel shader: triangles go first,
+                                     then quads, 2 triangles each **/
+                                 "#version 150 core\n"
+
+                                 SHD_FILE
+
+                                 "void Prim(out vec3 n, out vec3 c) {"
+                                     "ivec4 offs = texelFetch(pdsc, part * 2), cnts = texelFetch(pdsc, part * 2 + 1);"
+                                     "int prim = (gl_PrimitiveID < cnts.x) ? gl_PrimitiveID"
+                                              ": cnts.x + (gl_PrimitiveID - cnts.x) / 2;"
+                                     "n = normalize(vec3(-I8(offs.z + prim * 3), I8(offs.z + prim * 3 + 1), I8(offs.z + prim * 3 + 2)));"
+                                     "c = vec3((uvec3(U16(offs.w + prim * 2)) >> uvec3(10u, 5u, 0u)) & 31u) / 31.0;"
+                                 "}"
+
+                                 SHD_MAIN, uvbo + 1, 0);
+    else
+        retn->prog = MakeProgram(/** === main vertex shader **/
+                                 "#version 150 core\n"
+
+                                 "uniform mat4 mMVP;"
+                                 "uniform samplerBuffer ofsc;"
+
+                                 /** attributes **/
+                                 "in vec4 vert;"
+
+                                 "uniform vec3 ftrn;"
+
+                                 "smooth out vec3 v;"
+                                 "flat out int p;"
+
+                                 "void main() {"
+                                     "vec4 part = texelFetch(ofsc, int(vert.w));"
+                                     "vec3 vpos = (vert.xyz * vec3(1.0, -1.0, -1.0) / 32767.0 + part.xyz) * part.w;"
+                                     "v = -ftrn - vpos;"
+                                     "p = int(vert.w);"
+                                     "gl_Position = mMVP * vec4(vpos, 1.0);"
+                                 "}",
+
+                                 /** === main pixel shader: gl_PrimitiveID
+                                     restarts from 0 with every draw call,
+                                     hence the base **/
+                                 "#version 150 core\n"
+
+                                 "uniform isamplerBuffer prim;"
+                                 "uniform int pbas;"
+
+                                 "void Prim(out vec3 n, out vec3 c) {"
+                                     "ivec4 prim = texelFetch(prim, pbas + gl_PrimitiveID);"
+                                     "n = normalize(vec3(prim.xyz) * vec3(-1.0, 1.0, 1.0));"
+                                     "c = vec3((uvec3(prim.w) >> uvec3(10u, 5u, 0u)) & 31u) / 31.0;"
+                                 "}"
+
+                                 SHD_MAIN, uvbo + 1, 1);
+    retn->umvp = glGetUniformLocation(retn->prog, "mMVP");
+    retn->uftr = glGetUniformLocation(retn->prog, "ftrn");
+    retn->uprt = glGetUniformLocation(retn->prog, "part");
+    retn->upbs = glGetUniformLocation(retn->prog, "pbas");
+    retn->udbg = glGetUniformLocation(retn->prog, "dbug");
+    retn->cprt = prng->cdat / sizeof(*retn->prng);
+    retn->prng = malloc(prng->cdat);
+    memcpy(retn->prng, prng->pdat, prng->cdat);
+
+    ofsc = malloc(retn->cprt * sizeof(*ofsc));
+    for (long iter = 0; iter < retn->cprt; iter++)
+        ofsc[iter] = retn->prng[iter].ofsc;
+    retn->ttex[TBO_OFSC] = MakeTBuf(GL_RGBA32F, ofsc, retn->cprt * sizeof(*ofsc), &retn->tbuf[TBO_OFSC]);
+    free(ofsc);
+    retn->msta.vram += retn->cprt * sizeof(*ofsc);
+    retn->msta.cprt = retn->cprt;
+    for (long iter = 0; iter < retn->cprt; iter++)
+        retn->ctri += retn->prng[iter].size / 3;
+    glUseProgram(retn->prog);
+    for (long iter = 0; iter < TBO_LAST; iter++)
+        glUniform1i(glGetUniformLocation(retn->prog, smpl[iter]), iter);
+    glUseProgram(0);
+
+    /// all parts start out visible, and the first frames find out otherwise;
+    /// any-samples queries may stop at the first sample, and are core in 3.3
+    if (flgs & ENG_OCCLUSION) {
+        retn->occl = calloc(retn->cprt, sizeof(*retn->occl));
+        for (long iter = 0; iter < retn->cprt; iter++) {
+            glGenQueries(DEF_OFRM, retn->occl[iter].oqry);
+            retn->occl[iter].ovis = true;
+        }
+        retn->otyp = ((vmaj > 3) || ((vmaj == 3) && (vmin >= 3))) ? GL_ANY_SAMPLES_PASSED : GL_SAMPLES_PASSED;
+        retn->oprg = MakeProgram(/** === bounding box vertex shader: a strip
+                                     of 14 that walks all 6 faces of a cube,
+                                     corners encoded bitwise per axis **/
+                                 "#version 150 core\n"
+
+                                 "uniform mat4 mMVP;"
+                                 "uniform vec3 bmin, bmax;"
+
+                                 "void main() {"
+                                     "ivec3 bits = ivec3(0x287A, 0x02AF, 0x31E3) >> gl_VertexID;"
+                                     "gl_Position = mMVP * vec4(mix(bmin, bmax, vec3(bits & 1)), 1.0);"
+                                 "}",
+
+                                 /** === bounding box pixel shader: only
+                                     depth matters, and it is not written **/
+                                 "#version 150 core\n"
+
+                                 "out vec4 fclr;"
+
+                                 "void main() {"
+                                     "fclr = vec4(1.0);"
+                                 "}", 0, 0);
+        retn->omvp = glGetUniformLocation(retn->oprg, "mMVP");
+        retn->obmn = glGetUniformLocation(retn->oprg, "bmin");
+        retn->obmx = glGetUniformLocation(retn->oprg, "bmax");
+        /// no attributes, but core profile still needs a VAO to draw
+        glGenVertexArrays(1, &retn->ovao);
+    }
 
-    if (xmlOnly) {
-        cFreeEngine(&retn);
-        exit(0);
+    if (flgs & ENG_GPUDECODE) {
+        free(rvbo[1].pdat);
+        free(rvbo[2].pdat);
+        rFreeFile(&fmap);
     }
+    else if (cach.fptr)
+        rFreeFile(&cach);
+    else
+        for (long iter = 0; iter < cvbo; iter++)
+            free(uvbo[iter].pdat);
 
     return retn;
 }
@@ -630,7 +2330,47 @@ ENGC *cMakeEngine(char *name, bool xmlOnly) {
 
 
 void cFreeEngine(ENGC **engc) {
-    OGL_FreeVBO(&(*engc)->fvbo);
+    LatencyPoll(*engc, true);
+    LatencyReport(*engc);
+    for (long iter = 0; (*engc)->ltim && (iter < DEF_LFRM); iter++)
+        glDeleteQueries(2, (*engc)->lfrm[iter].tqry);
+#ifdef PRF_ZONES
+    GPUZones(*engc, true);
+    if ((*engc)->ltim)
+        glDeleteQueries(DEF_LFRM, (*engc)->gqry);
+#endif
+    PRF_SAVE();
+#ifndef _WIN32
+    /// a connection of its own wakes the socket thread up to see mstp set
+    if ((*engc)->mpth) {
+        struct sockaddr_un addr = {.sun_family = AF_UNIX};
+        char *path = (*engc)->mpth;
+        int csck;
+
+        strcpy(addr.sun_path, path);
+        atomic_store(&(*engc)->mstp, true);
+        if ((csck = socket(AF_UNIX, SOCK_STREAM, 0)) >= 0) {
+            connect(csck, (struct sockaddr*)&addr, sizeof(addr));
+            close(csck);
+        }
+        pthread_join((*engc)->mthr, 0);
+        close((*engc)->msck);
+        unlink(path);
+        free(path);
+    }
+#endif
+    if ((*engc)->occl) {
+        for (long iter = 0; iter < (*engc)->cprt; iter++)
+            glDeleteQueries(DEF_OFRM, (*engc)->occl[iter].oqry);
+        glDeleteVertexArrays(1, &(*engc)->ovao);
+        glDeleteProgram((*engc)->oprg);
+        free((*engc)->occl);
+    }
+    FreeMesh(&(*engc)->mesh);
+    free((*engc)->prng);
+    glDeleteTextures(TBO_LAST, (*engc)->ttex);
+    glDeleteBuffers(TBO_LAST, (*engc)->tbuf);
+    glDeleteProgram((*engc)->prog);
 
     VEC_PurgeMatrixStack(&(*engc)->proj);
     VEC_PurgeMatrixStack(&(*engc)->view);
@@ -3,7 +3,8 @@
 
 
 
-#define DEF_UTMR   8 /** Default interval of the state-updating timer **/
+#define DEF_UTMR   8 /** Default interval of the state-updating timer,
+                          and the simulation step it stands for, ms   **/
 
 enum {
     /** = 'no such key!' = **/
@@ -61,12 +62,36 @@ enum {
 
 
 
+/** cMakeEngine() flags **/
+enum {
+    ENG_GPUDECODE = 1 << 0, /** leave decoding to the vertex shader     **/
+    ENG_OCCLUSION = 1 << 1, /** skip parts that occlusion queries hide  **/
+};
+
+
+
+/** cBenchDecode() stages **/
+enum {
+    BCH_INDX, /** triangle & quad indices                 **/
+    BCH_VERT, /** vertices, gathered to the corners       **/
+    BCH_NORM, /** prim normals                            **/
+    BCH_CLRS, /** prim colors                             **/
+    BCH_LAST
+};
+
+
+
 typedef struct ENGC ENGC;
 
-void cUpdateState(ENGC *engc);
-void cMouseInput(ENGC *engc, long xpos, long ypos, long btns);
-void cKbdInput(ENGC *engc, uint8_t code, long down);
-void cResizeWindow(ENGC *engc, long xdim, long ydim);
+bool cUpdateState(ENGC *engc);
+bool cMouseInput(ENGC *engc, long xpos, long ypos, long btns, uint64_t time);
+bool cKbdInput(ENGC *engc, uint8_t code, long down, uint64_t time);
+bool cResizeWindow(ENGC *engc, long xdim, long ydim);
+void cGetCamera(ENGC *engc, float ftrn[3], float fang[2]);
+void cSetCamera(ENGC *engc, float ftrn[3], float fang[2]);
 void cRedrawWindow(ENGC *engc);
+void cSwapDone(ENGC *engc);
+bool cServeStats(ENGC *engc, char *path);
 void cFreeEngine(ENGC **engc);
-ENGC *cMakeEngine(char *name, bool xmlOnly);
+ENGC *cMakeEngine(char *name, uint32_t flgs);
+long cBenchDecode(char *name, long reps, uint64_t *time, uint64_t *size);
@@ -0,0 +1,723 @@
+#include "wl3.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <pthread.h>
+#include <time.h>
+#endif
+#ifdef PRF_ZONES
+#include <stdatomic.h>
+#endif
+
+
+
+#define DEF_OBSZ (1 << 20)   /** Tag output buffer size            **/
+#define DEF_TBAT (1 << 18)   /** Tags per batch of parallel parts  **/
+#define DEF_TMAG 0x544E4357  /** Binary tag file magic, 'WCNT'     **/
+#define DEF_ZMAX (1 << 18)   /** Most profiler zones recorded      **/
+#define DEF_ZOUT "wcn-trace.json"  /** Default trace file name     **/
+
+
+
+char *rLoadFile(char *name, long *size) {
+    PRF_BGN(zone);
+    char *retn = 0;
+    long file, flen;
+
+    if ((file = open(name, O_RDONLY)) >= 0) {
+        flen = lseek(file, 0, SEEK_END);
+        lseek(file, 0, SEEK_SET);
+        retn = malloc(flen + 1);
+        if (read(file, retn, flen) == flen) {
+            retn[flen] = '\0';
+            if (size)
+                *size = flen;
+        }
+        else {
+            free(retn);
+            retn = 0;
+        }
+        close(file);
+    }
+    PRF_END(zone, "rLoadFile");
+    return retn;
+}
+
+/// maps the file read-only, falling back to rLoadFile() when mmap() is not
+/// an option (empty files, pipes, platforms without it); fmap->fmap tells
+/// rFreeFile() which of the two it has to undo
+bool rMapFile(FMAP *fmap, char *name) {
+    *fmap = (FMAP){};
+#ifndef _WIN32
+    struct stat fsta;
+    long file;
+
+    if ((file = open(name, O_RDONLY)) < 0)
+        return false;
+    if (!fstat(file, &fsta) && S_ISREG(fsta.st_mode) && (fsta.st_size > 0)) {
+        fmap->fptr = mmap(0, fsta.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (fmap->fptr != MAP_FAILED) {
+            /// parts are visited out of order, so read-ahead the whole thing
+            madvise(fmap->fptr, fsta.st_size, MADV_WILLNEED);
+            fmap->flen = fsta.st_size;
+            fmap->fmap = true;
+        }
+        else
+            fmap->fptr = 0;
+    }
+    close(file);
+    if (fmap->fmap)
+        return true;
+#endif
+    return !!(fmap->fptr = rLoadFile(name, &fmap->flen));
+}
+
+void rFreeFile(FMAP *fmap) {
+#ifndef _WIN32
+    if (fmap->fmap)
+        munmap(fmap->fptr, fmap->flen);
+    else
+#endif
+    free(fmap->fptr);
+    *fmap = (FMAP){};
+}
+
+/// at the Part Table offset there`s a vector prepended by its total byte size
+/// that contains offsets to Part Tables (except the last one - it comes
+/// directly after the said vector); returns 0 when indx is out of range
+struct PART *rPartAt(char *file, long indx, long *cprt) {
+    struct WL3H *wl3h = (void*)file;
+    long offs = U32_SWAP(wl3h->offsPart), size = U32_SWAP(*(uint32_t*)(file + offs));
+
+    if (cprt)
+        *cprt = size / 4;
+    if ((indx < 0) || (indx >= size / 4))
+        return 0;
+    indx = (indx + 1) * 4;
+    return (void*)(file + offs + ((indx == size) ? size : U32_SWAP(*(uint32_t*)(file + offs + indx))));
+}
+
+/// the one place that knows how the blocks of a part are laid out, so that
+/// the passes over the part (decoding, tagging) have nothing left to parse
+bool rPartBlocks(PBLK *pblk, char *file, long indx) {
+    struct PART *part;
+
+    if (!(part = rPartAt(file, indx, 0)))
+        return false;
+    pblk->part = part;
+    pblk->tidx = (uint16_t*)((char*)part + U32_SWAP(part->pidx) + 2);
+    pblk->tri  = U16_SWAP(pblk->tidx[-1]);
+    pblk->qidx = pblk->tidx + pblk->tri * 3 + 1;
+    pblk->qua  = U16_SWAP(pblk->qidx[-1]);
+    pblk->vert = (int16_t*)((char*)part + U32_SWAP(part->vert));
+    pblk->texc = (uint8_t*)part + U32_SWAP(part->texc) + 2;
+    pblk->pnrm = (int8_t*)part + U32_SWAP(part->pnrm);
+    pblk->vnrm = (int8_t*)part + U32_SWAP(part->vnrm);
+    pblk->attr = (uint16_t*)((char*)part + U32_SWAP(part->attr));
+    pblk->nvtx = U32_SWAP(part->numVert);
+    pblk->nprm = U32_SWAP(part->numPrim);
+    return true;
+}
+
+
+
+/// true if all that rPartAt(), rPartBlocks(), PartStats() and the tag
+/// passes read or tag of the file lies within its flen bytes: the header,
+/// the tail size, the part table vector, every part record, its index
+/// counts and every block it points to, so that no count is believed that
+/// the file has no room for; sizes go 64-bit, so that no offset from the
+/// file can overflow them
+bool FileFits(char *file, long flen) {
+    int64_t offs, size, part, tidx, tri, qua, nprm;
+    struct PART *prec;
+
+    if ((flen < sizeof(struct WL3H))
+    ||  ((int64_t)U32_SWAP(((struct WL3H*)file)->offsTail) + 2 > flen))
+        return false;
+    offs = U32_SWAP(((struct WL3H*)file)->offsPart);
+    if (offs + 4 > flen)
+        return false;
+    size = U32_SWAP(*(uint32_t*)(file + offs));
+    if (offs + size > flen)
+        return false;
+    for (int64_t indx = 4; indx <= size - size % 4; indx += 4) {
+        if ((indx != size) && (offs + indx + 4 > flen))
+            return false;
+        part = offs + ((indx == size) ? size : U32_SWAP(*(uint32_t*)(file + offs + indx)));
+        if (part + (int64_t)sizeof(*prec) > flen)
+            return false;
+        prec = (void*)(file + part);
+        tidx = part + U32_SWAP(prec->pidx);
+        if (tidx + 2 > flen)
+            return false;
+        tri = U16_SWAP(*(uint16_t*)(file + tidx));
+        if (tidx + 2 + tri * 6 + 2 > flen)
+            return false;
+        qua = U16_SWAP(*(uint16_t*)(file + tidx + 2 + tri * 6));
+        nprm = U32_SWAP(prec->numPrim);
+        if ((tidx + 2 + tri * 6 + 2 + qua * 8 > flen)
+        ||  (part + U32_SWAP(prec->vert) + (int64_t)U32_SWAP(prec->numVert) * 6 > flen)
+        ||  (part + U32_SWAP(prec->texc) + 2 + nprm * 4 > flen)
+        ||  (part + U32_SWAP(prec->pnrm) + nprm * 3 > flen)
+        ||  (part + U32_SWAP(prec->vnrm) + (tri * 3 + qua * 4) * 3 > flen)
+        ||  (part + U32_SWAP(prec->attr) + nprm * 2 > flen))
+            return false;
+    }
+    return true;
+}
+
+/// bounds come from all the vertices a part has, transformed the way the
+/// renderer does it: Y and Z get negated, so their extremes may swap places
+void PartStats(FSTA *fsta, PBLK *pblk) {
+    float half = 0.5 / I32_SWAP(pblk->part->offset[0]), scal = (float)I32_SWAP(pblk->part->offset[0]) / 0x7FFFF;
+    int16_t vmin[3] = {0x7FFF, 0x7FFF, 0x7FFF}, vmax[3] = {-0x8000, -0x8000, -0x8000};
+    float sign[3] = {1.f, -1.f, -1.f}, bnd0, bnd1, temp;
+    long iter;
+
+    fsta->tri += pblk->tri;
+    fsta->qua += pblk->qua;
+    fsta->vtx += pblk->nvtx;
+    for (iter = 0; (iter < fsta->ctex) && memcmp(fsta->ptex[iter], pblk->part->tex, sizeof(*fsta->ptex)); iter++);
+    if (iter == fsta->ctex)
+        memcpy(fsta->ptex[fsta->ctex++], pblk->part->tex, sizeof(*fsta->ptex));
+    if (!pblk->nvtx)
+        return;
+    for (iter = 0; iter < pblk->nvtx * 3; iter++) {
+        int16_t vert = I16_SWAP(pblk->vert[iter]);
+        vmin[iter % 3] = (vert < vmin[iter % 3]) ? vert : vmin[iter % 3];
+        vmax[iter % 3] = (vert > vmax[iter % 3]) ? vert : vmax[iter % 3];
+    }
+    for (iter = 0; iter < 3; iter++) {
+        float plus = sign[iter] * half * I32_SWAP(pblk->part->offset[iter + 1]);
+        bnd0 = (sign[iter] / 0x7FFF * vmin[iter] + plus) * scal;
+        bnd1 = (sign[iter] / 0x7FFF * vmax[iter] + plus) * scal;
+        if (bnd0 > bnd1) {
+            temp = bnd0;
+            bnd0 = bnd1;
+            bnd1 = temp;
+        }
+        if (!fsta->cbnd || (bnd0 < fsta->bmin[iter]))
+            fsta->bmin[iter] = bnd0;
+        if (!fsta->cbnd || (bnd1 > fsta->bmax[iter]))
+            fsta->bmax[iter] = bnd1;
+    }
+    fsta->cbnd++;
+}
+
+/// reads the header and walks the part table, touching nothing of a part
+/// but its vertices; the texture list is to be freed with rFreeStats(),
+/// and there is none when the file is too short for what it says it holds
+bool rFileStats(FSTA *fsta, char *name) {
+    uint64_t tbgn = rTimeNow();
+    struct WL3H *wl3h;
+    PBLK pblk;
+    FMAP fmap;
+
+    *fsta = (FSTA){};
+    if (!rMapFile(&fmap, name))
+        return false;
+    if (!FileFits(fmap.fptr, fmap.flen)) {
+        rFreeFile(&fmap);
+        return false;
+    }
+    wl3h = (void*)fmap.fptr;
+    fsta->flen = fmap.flen;
+    fsta->offs[0] = U32_SWAP(wl3h->offsPart);
+    fsta->offs[1] = U32_SWAP(wl3h->offsUnk);
+    fsta->offs[2] = U32_SWAP(wl3h->offsColi);
+    fsta->offs[3] = U32_SWAP(wl3h->offsTail);
+    fsta->hprt = U32_SWAP(wl3h->numPart);
+    fsta->hvtx = U32_SWAP(wl3h->numVert);
+    fsta->hprm = U32_SWAP(wl3h->numPrim);
+    fsta->hsiz = U16_SWAP(wl3h->hdrSize);
+    fsta->hobj = U16_SWAP(wl3h->hdrObjs);
+    memcpy(fsta->name, wl3h->name, sizeof(wl3h->name));
+
+    rPartAt(fmap.fptr, 0, &fsta->cprt);
+    fsta->ptex = malloc(fsta->cprt * sizeof(*fsta->ptex));
+    for (long iter = 0; rPartBlocks(&pblk, fmap.fptr, iter); iter++)
+        PartStats(fsta, &pblk);
+    rFreeFile(&fmap);
+    fsta->tpar = rTimeNow() - tbgn;
+    return true;
+}
+
+void rFreeStats(FSTA *fsta) {
+    free(fsta->ptex);
+    fsta->ptex = 0;
+}
+
+
+
+typedef struct {
+    void (*func)(void *user, long indx);
+    void *user;
+    long size, next;
+} POOL;
+
+#ifdef _WIN32
+DWORD APIENTRY PoolFunc(LPVOID user) {
+#else
+void *PoolFunc(void *user) {
+#endif
+    POOL *pool = user;
+
+    for (long indx; (indx = __sync_fetch_and_add(&pool->next, 1)) < pool->size;)
+        pool->func(pool->user, indx);
+    return 0;
+}
+
+long rCountCPUs(void) {
+#ifdef _WIN32
+    SYSTEM_INFO syin;
+
+    GetSystemInfo(&syin);
+    return syin.dwNumberOfProcessors;
+#else
+    return sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+/// nanoseconds from some fixed point in the past, never going backwards
+uint64_t rTimeNow(void) {
+#ifdef _WIN32
+    LARGE_INTEGER tcur, tfrq;
+
+    QueryPerformanceCounter(&tcur);
+    QueryPerformanceFrequency(&tfrq);
+    return (uint64_t)(tcur.QuadPart / tfrq.QuadPart) * 1000000000
+         + (uint64_t)(tcur.QuadPart % tfrq.QuadPart) * 1000000000 / tfrq.QuadPart;
+#else
+    struct timespec tcur;
+
+    clock_gettime(CLOCK_MONOTONIC, &tcur);
+    return (uint64_t)tcur.tv_sec * 1000000000 + tcur.tv_nsec;
+#endif
+}
+
+/// calls func(user, 0...size - 1) on as many threads as there are CPUs,
+/// the calling thread included; returns when all calls are done
+void rParallelFor(long size, void (*func)(void*, long), void *user) {
+    POOL pool = {func, user, size, 0};
+    long iter, cthr = rCountCPUs();
+#ifdef _WIN32
+    HANDLE *thrd;
+#else
+    pthread_t *thrd;
+#endif
+
+    if (cthr > size)
+        cthr = size;
+    thrd = (cthr > 1) ? calloc(cthr - 1, sizeof(*thrd)) : 0;
+    for (iter = 0; iter < cthr - 1; iter++)
+#ifdef _WIN32
+        if (!(thrd[iter] = CreateThread(0, 0, PoolFunc, &pool, 0, 0)))
+#else
+        if (pthread_create(&thrd[iter], 0, PoolFunc, &pool))
+#endif
+            break;
+    PoolFunc(&pool);
+    while (--iter >= 0)
+#ifdef _WIN32
+        WaitForSingleObject(thrd[iter], INFINITE), CloseHandle(thrd[iter]);
+#else
+        pthread_join(thrd[iter], 0);
+#endif
+    free(thrd);
+}
+
+
+
+/// output is gathered here and handed to write() in big chunks; numbers and
+/// colours are formatted by hand, printf() being the bottleneck otherwise;
+/// a buffer with no descriptor grows instead, to be written out later
+typedef struct {
+    char *bptr;  /** buffer                                 **/
+    long  bsiz;  /** buffer size, DEF_OBSZ if flushed       **/
+    long  bcur;  /** bytes pending                          **/
+    long  ctag;  /** tags written so far, also the next id  **/
+    long  tfmt;  /** TAG_XML, TAG_JSON or TAG_BIN           **/
+    int   file;  /** descriptor the buffer is flushed to, -1 if none **/
+    bool  fail;  /** true once any write() has failed       **/
+} OBUF;
+
+/// binary tag record, host byte order, followed by tlen bytes of text;
+/// a record with all bits set ends the file
+#pragma pack(push, 1)
+typedef struct {
+    int32_t  bgn, end;
+    uint32_t fclr, nclr;
+    uint16_t tlen;
+} TREC;
+#pragma pack(pop)
+
+void PutFlush(OBUF *obuf) {
+    for (long iter = 0, size; iter < obuf->bcur; iter += size)
+        if ((size = write(obuf->file, obuf->bptr + iter, obuf->bcur - iter)) <= 0) {
+            obuf->fail = true;
+            break;
+        }
+    obuf->bcur = 0;
+}
+
+/// makes room for size more bytes; nothing longer than DEF_OBSZ is ever
+/// asked for, as long strings go through PutData()
+char *PutRoom(OBUF *obuf, long size) {
+    if (obuf->bcur + size > obuf->bsiz) {
+        if (obuf->file >= 0)
+            PutFlush(obuf);
+        else
+            obuf->bptr = realloc(obuf->bptr, obuf->bsiz = (obuf->bcur + size) * 2);
+    }
+    return obuf->bptr + obuf->bcur;
+}
+
+void PutData(OBUF *obuf, void *data, long size) {
+    for (long iter; size > 0; data = (char*)data + iter, size -= iter) {
+        iter = (size < DEF_OBSZ / 2) ? size : DEF_OBSZ / 2;
+        memcpy(PutRoom(obuf, iter), data, iter);
+        obuf->bcur += iter;
+    }
+}
+
+char *PutStr(char *bptr, char *text, long size) {
+    memcpy(bptr, text, size);
+    return bptr + size;
+}
+
+char *PutDec(char *bptr, long numb) {
+    char temp[24], *tptr = temp + sizeof(temp);
+    unsigned long uval = (numb < 0) ? -(unsigned long)numb : numb;
+
+    do
+        *--tptr = '0' + uval % 10;
+    while (uval /= 10);
+    if (numb < 0)
+        *bptr++ = '-';
+    return PutStr(bptr, tptr, temp + sizeof(temp) - tptr);
+}
+
+char *PutHex(char *bptr, uint32_t numb, long digs) {
+    for (long iter = digs - 1; iter >= 0; iter--, numb >>= 4)
+        bptr[iter] = "0123456789ABCDEF"[numb & 0xF];
+    return bptr + digs;
+}
+
+/// the only user-supplied string is the file name, hence JSON escaping and
+/// nothing else; XML keeps it verbatim, as it always did
+void PutJSON(OBUF *obuf, char *text) {
+    for (; *text; text++) {
+        char *bptr = PutRoom(obuf, 6);
+        if ((*text == '"') || (*text == '\\'))
+            bptr = PutStr(bptr, (char[]){'\\', *text}, 2);
+        else if ((uint8_t)*text < 0x20)
+            bptr = PutHex(PutStr(bptr, "\\u", 2), (uint8_t)*text, 4);
+        else
+            *bptr++ = *text;
+        obuf->bcur = bptr - obuf->bptr;
+    }
+}
+
+#define PUT_LIT(b, s) PutStr((b), (s), sizeof(s) - 1)
+#define PUT_DAT(o, s) PutData((o), (s), sizeof(s) - 1)
+
+void PutTag(OBUF *obuf, long bgn, long len, uint32_t fclr, uint32_t nclr, char *name) {
+    long tlen = strlen(name);
+    char *bptr = PutRoom(obuf, tlen + 256);
+
+    switch (obuf->tfmt) {
+        case TAG_XML:
+            bptr = PutDec(PUT_LIT(bptr, "    <TAG id=\""), obuf->ctag);
+            bptr = PutDec(PUT_LIT(bptr, "\">\n      <start_offset>"), bgn);
+            bptr = PutDec(PUT_LIT(bptr, "</start_offset>\n      <end_offset>"), bgn + len - 1);
+            bptr = PutStr(PUT_LIT(bptr, "</end_offset>\n      <tag_text>"), name, tlen);
+            bptr = PutHex(PUT_LIT(bptr, "</tag_text>\n      <font_colour>#"), fclr, 6);
+            bptr = PutHex(PUT_LIT(bptr, "</font_colour>\n      <note_colour>#"), nclr, 6);
+            bptr = PUT_LIT(bptr, "</note_colour>\n    </TAG>\n");
+            break;
+
+        case TAG_JSON:
+            bptr = PutDec(PUT_LIT(bptr, "{\"id\":"), obuf->ctag);
+            bptr = PutDec(PUT_LIT(bptr, ",\"start\":"), bgn);
+            bptr = PutDec(PUT_LIT(bptr, ",\"end\":"), bgn + len - 1);
+            bptr = PutStr(PUT_LIT(bptr, ",\"text\":\""), name, tlen);
+            bptr = PutHex(PUT_LIT(bptr, "\",\"font\":\"#"), fclr, 6);
+            bptr = PutHex(PUT_LIT(bptr, "\",\"note\":\"#"), nclr, 6);
+            bptr = PUT_LIT(bptr, "\"}\n");
+            break;
+
+        case TAG_BIN:
+            bptr = PutStr(bptr, (char*)&(TREC){bgn, bgn + len - 1, fclr, nclr, tlen}, sizeof(TREC));
+            bptr = PutStr(bptr, name, tlen);
+            break;
+    }
+    obuf->bcur = bptr - obuf->bptr;
+    obuf->ctag++;
+}
+
+/// exactly as many as PartTags() puts; the part`s first tag id is the sum
+/// of these over all the parts before it
+long PartTagCount(PBLK *pblk) {
+    return 16 + 1 + pblk->tri + 1 + pblk->qua + pblk->nvtx + 1 + pblk->nprm * 3 + pblk->tri * 3 + pblk->qua * 4;
+}
+
+void PartTags(OBUF *obuf, char *file, PBLK *pblk) {
+    struct PART *part = pblk->part;
+    long tri = pblk->tri, qua = pblk->qua;
+    char *fptr;
+
+    PutTag(obuf, (char*)part - file +   0, 4, 0x0000FF, 0x9070E0, "part: prim indices");
+    PutTag(obuf, (char*)part - file +   4, 4, 0x000000, 0x9070E0, "part: vertices");
+    PutTag(obuf, (char*)part - file +   8, 4, 0x000000, 0x9070E0, "part: texcoords");
+    PutTag(obuf, (char*)part - file +  12, 4, 0x000000, 0x9070E0, "part: prim normals");
+    PutTag(obuf, (char*)part - file +  16, 4, 0x000000, 0x9070E0, "part: vertex normals");
+    PutTag(obuf, (char*)part - file +  20, 4, 0x000000, 0x9070E0, "part: prim attrs");
+    PutTag(obuf, (char*)part - file +  24, 4, 0x000000, 0x204A87, "part: vertex count");
+    PutTag(obuf, (char*)part - file +  28, 4, 0x000000, 0xCF5C00, "part: prim count");
+    PutTag(obuf, (char*)part - file +  32, 4 * 3, 0x000000, 0x41F356, "part: (D,D, part scale)");
+    PutTag(obuf, (char*)part - file +  44, 4 * 3, 0x000000, 0x41F356, "part: offsets (X,Y,Z)");
+    PutTag(obuf, (char*)part - file +  56, 4 * 3, 0x000000, 0x41F356, "part: (D,D,D)");
+    PutTag(obuf, (char*)part - file +  68, 4, 0x000000, 0x557C2A, "part: (usually 0) (?)");
+    PutTag(obuf, (char*)part - file +  72, 16, 0x000000, 0x557C2A, "part: (W,W,D,D,D)");
+    PutTag(obuf, (char*)part - file +  88, 12, 0x000000, 0x9070E0, "part: texture");
+    PutTag(obuf, (char*)part - file + 100, 2, 0x000000, 0x901090, "part: tail size");
+    PutTag(obuf, (char*)part - file + 102, 2, 0x000000, 0x901090, "part: tail objs");
+
+    /// indices: triangles
+
+    fptr = (char*)pblk->tidx;
+    PutTag(obuf, fptr - file - 2, 2, 0x0000FF, 0xFCAF3E, "triangle count");
+    for (long iter = 0; iter < tri; iter++)
+        PutTag(obuf, fptr - file + iter * 6, 6, 0x000000, (iter & 1) ? 0xFCAF3E : 0xCF5C00, "");
+
+    /// indices: quads
+
+    fptr = (char*)pblk->qidx;
+    PutTag(obuf, fptr - file - 2, 2, 0x000000, (tri & 1) ? 0xFCAF3E : 0xCF5C00, "quad count");
+    for (long iter = 0; iter < qua; iter++)
+        PutTag(obuf, fptr - file + iter * 8, 8, 0x000000, ((tri + iter) & 1) ? 0xCF5C00 : 0xFCAF3E, "");
+
+    /// vertices
+
+    fptr = (char*)pblk->vert;
+    for (long iter = 0; iter < pblk->nvtx; iter++)
+        PutTag(obuf, fptr - file + iter * 6, 6, (iter) ? 0x000000 : 0x0000FF, (iter & 1) ? 0x204A87 : 0x729FCF, "");
+
+    /// texcoords
+
+    fptr = (char*)pblk->texc;
+    PutTag(obuf, fptr - file - 2, 2, 0x0000FF, 0xFCAF3E, "texcoord count, never used");
+    for (long iter = 0; iter < pblk->nprm; iter++)
+        PutTag(obuf, fptr - file + iter * 4, 4, 0x000000, (iter & 1) ? 0xFCAF3E : 0xCF5C00, "");
+
+    /// prim normals
+
+    fptr = (char*)pblk->pnrm;
+    for (long iter = 0; iter < pblk->nprm; iter++)
+        PutTag(obuf, fptr - file + iter * 3, 3, (iter) ? 0x000000 : 0x0000FF, (iter & 1) ? 0x204A87 : 0x729FCF, "");
+
+    /// vertex normals: 3 per triangle, then 4 per quad
+
+    fptr = (char*)pblk->vnrm;
+    for (long iter = 0; iter < tri * 3; iter++)
+        PutTag(obuf, fptr - file + iter * 3, 3, (iter) ? 0x000000 : 0x0000FF, (iter & 1) ? 0x204A87 : 0x729FCF, "");
+    fptr += tri * 3 * 3;
+    for (long iter = 0; iter < qua * 4; iter++)
+        PutTag(obuf, fptr - file + iter * 3, 3, 0x000000, (iter & 1) ? 0x204A87 : 0x729FCF, "");
+
+    /// prim attributes
+
+    fptr = (char*)pblk->attr;
+    for (long iter = 0; iter < pblk->nprm; iter++)
+        PutTag(obuf, fptr - file + iter * 2, 2, (iter) ? 0x000000 : 0x0000FF, (iter & 1) ? 0xFCAF3E : 0xCF5C00, "");
+}
+
+typedef struct {
+    OBUF *pbuf;
+    PBLK *pblk;
+    char *file;
+} TDAT;
+
+void TagsFunc(void *user, long indx) {
+    TDAT *tdat = user;
+
+    PartTags(&tdat->pbuf[indx], tdat->file, &tdat->pblk[indx]);
+}
+
+/// tags every known block of the file in the format given; only walks the
+/// offsets and counts, so neither GL nor anything float is ever touched,
+/// and fails with nothing written when they point out of the file.
+/// With more than one CPU, parts are tagged in parallel, in batches of
+/// about DEF_TBAT tags, each part to a buffer of its own that starts from
+/// its precounted tag id; buffers are then written out in file order
+bool rDumpTags(int dest, char *name, long tfmt) {
+    struct WL3H *wl3h;
+    char *fptr, *file;
+    long cprt, cnxt;
+    OBUF *obuf;
+    TDAT tdat;
+    FMAP fmap;
+    PBLK pblk;
+
+    if (!rMapFile(&fmap, name))
+        return false;
+    if (!FileFits(fmap.fptr, fmap.flen)) {
+        rFreeFile(&fmap);
+        return false;
+    }
+    file = fmap.fptr;
+    wl3h = (void*)file;
+    obuf = &(OBUF){malloc(DEF_OBSZ), DEF_OBSZ, 0, 0, tfmt, dest};
+
+    switch (tfmt) {
+        case TAG_XML:
+            PUT_DAT(obuf, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<wxHexEditor_XML_TAG>\n  <filename path=\"");
+            PutData(obuf, name, strlen(name));
+            PUT_DAT(obuf, "\">\n");
+            break;
+
+        case TAG_JSON:
+            PUT_DAT(obuf, "{\"file\":\"");
+            PutJSON(obuf, name);
+            PUT_DAT(obuf, "\"}\n");
+            break;
+
+        case TAG_BIN:
+            PutData(obuf, &(uint32_t){DEF_TMAG}, sizeof(uint32_t));
+            PutData(obuf, &(uint32_t){strlen(name)}, sizeof(uint32_t));
+            PutData(obuf, name, strlen(name));
+            break;
+    }
+
+    PutTag(obuf, (char*)&wl3h->offsPart - file, 4, 0x000000, 0x55C6C3, "part table offset");
+    PutTag(obuf, (char*)&wl3h->offsUnk - file, 4, 0x000000, 0x906000, "unknown struct offset");
+    PutTag(obuf, (char*)&wl3h->offsColi - file, 4, 0x000000, 0xF03030, "colitab offset");
+    PutTag(obuf, (char*)&wl3h->offsTail - file, 4, 0x000000, 0x9A1490, "tail offset");
+    PutTag(obuf, (char*)&wl3h->numPart - file, 4, 0x000000, 0x55C6C3, "part table size");
+    PutTag(obuf, (char*)&wl3h->numVert - file, 4, 0x000000, 0x204A87, "total vertex count");
+    PutTag(obuf, (char*)&wl3h->numPrim - file, 4, 0x000000, 0xCF5C00, "total prim count");
+    PutTag(obuf, (char*)&wl3h->name - file, 16, 0x000000, 0x5ED505, "name");
+
+    PutTag(obuf, (char*)&wl3h->hdrSize - file, 2, 0x000000, 0xEFD43B, "header size");
+    PutTag(obuf, (char*)&wl3h->hdrSize - file + 2, 2, 0x000000, 0xEFD43B, "header objs");
+    PutTag(obuf, (char*)&wl3h->hdrSize - file + 4, U16_SWAP(wl3h->hdrSize), 0x000000, 0xEFD43B, "header");
+
+    fptr = (char*)file + U32_SWAP(wl3h->offsUnk);
+    for (long iter = 0, size = (fptr != file) ? U32_SWAP(wl3h->numPart) * 2 - 1 : 0; iter < size; iter++)
+        PutTag(obuf, fptr - file + iter * 20, 20, 0x000000, (iter & 1) ? 0x906000 : 0xF0C070, "");
+
+    fptr = (char*)file + U32_SWAP(wl3h->offsColi);
+    if (fptr != file)
+        PutTag(obuf, fptr - file, 2, 0x000000, 0xF03030, "colitab");
+
+    fptr = (char*)file + U32_SWAP(wl3h->offsTail) + 2;
+    PutTag(obuf, fptr - file - 2, 2, 0x000000, 0x9A1490, "tail size");
+    PutTag(obuf, fptr - file, U16_SWAP(((uint16_t*)fptr)[-1]) * 2, 0x000000, 0x9A1490, "tail");
+
+    rPartAt(file, 0, &cprt);
+    if (cprt)
+        PutTag(obuf, U32_SWAP(wl3h->offsPart), U32_SWAP(*(uint32_t*)(file + U32_SWAP(wl3h->offsPart))),
+               0x000000, 0x55C6C3, "part table");
+    if (rCountCPUs() < 2)
+        for (long iter = 0; rPartBlocks(&pblk, file, iter); iter++)
+            PartTags(obuf, file, &pblk);
+    else {
+        /// the buffers are indexed by the part`s place in the batch, so
+        /// that the next batch reuses whatever the last one has allocated
+        tdat = (TDAT){calloc(cprt, sizeof(*tdat.pbuf)), malloc(cprt * sizeof(*tdat.pblk)), file};
+        for (long iter = 0, cbat; iter < cprt; iter = cnxt) {
+            for (cnxt = iter, cbat = obuf->ctag; (cnxt < cprt) && (obuf->ctag - cbat < DEF_TBAT); cnxt++) {
+                OBUF *pbuf = &tdat.pbuf[cnxt - iter];
+
+                rPartBlocks(&tdat.pblk[cnxt - iter], file, cnxt);
+                *pbuf = (OBUF){pbuf->bptr, pbuf->bsiz, 0, obuf->ctag, tfmt, -1};
+                obuf->ctag += PartTagCount(&tdat.pblk[cnxt - iter]);
+            }
+            rParallelFor(cnxt - iter, TagsFunc, &tdat);
+            PutFlush(obuf);
+            for (long indx = 0; indx < cnxt - iter; indx++) {
+                tdat.pbuf[indx].file = dest;
+                PutFlush(&tdat.pbuf[indx]);
+                obuf->fail |= tdat.pbuf[indx].fail;
+            }
+        }
+        for (long iter = 0; iter < cprt; iter++)
+            free(tdat.pbuf[iter].bptr);
+        free(tdat.pblk);
+        free(tdat.pbuf);
+    }
+
+    if (tfmt == TAG_XML)
+        PUT_DAT(obuf, "  </filename>\n</wxHexEditor_XML_TAG>\n");
+    else if (tfmt == TAG_BIN)
+        PutData(obuf, &(TREC){-1, -1, ~0, ~0, ~0}, sizeof(TREC));
+    PutFlush(obuf);
+    free(obuf->bptr);
+    rFreeFile(&fmap);
+    return !obuf->fail;
+}
+
+
+
+#ifdef PRF_ZONES
+typedef struct {
+    char *name;
+    uint64_t tbgn, tend;
+    long ztid;  /** thread the zone ran on, 0 for the GPU         **/
+} ZONE;
+
+static ZONE zbuf[DEF_ZMAX];
+static atomic_long zcnt, zthr;
+static _Thread_local long ztid;
+
+/// a slot is taken with a single atomic add, and a thread gets its id on
+/// its first zone; zones past DEF_ZMAX are counted, but not kept
+void rZoneAdd(char *name, bool gpuz, uint64_t tbgn, uint64_t tend) {
+    long indx = atomic_fetch_add_explicit(&zcnt, 1, memory_order_relaxed);
+
+    if (!gpuz && !ztid)
+        ztid = atomic_fetch_add_explicit(&zthr, 1, memory_order_relaxed) + 1;
+    if (indx < DEF_ZMAX)
+        zbuf[indx] = (ZONE){name, tbgn, tend, (gpuz) ? 0 : ztid};
+}
+
+/// Chrome trace-event JSON, to be opened in Perfetto or chrome://tracing;
+/// goes to $WCN_TRACE, or to DEF_ZOUT in the current directory
+bool rZoneSave(void) {
+    long size = atomic_load(&zcnt), thrd = atomic_load(&zthr);
+    char *name = getenv("WCN_TRACE");
+    FILE *file;
+    bool retn;
+
+    if (!(file = fopen((name && *name) ? name : DEF_ZOUT, "w")))
+        return false;
+    if (size > DEF_ZMAX) {
+        fprintf(stderr, "%ld profiler zones dropped, %d kept\n", size - DEF_ZMAX, DEF_ZMAX);
+        size = DEF_ZMAX;
+    }
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                  "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"GPU\"}}");
+    for (long iter = 1; iter <= thrd; iter++)
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%ld,"
+                      "\"args\":{\"name\":\"CPU %ld\"}}", iter, iter);
+    for (long iter = 0; iter < size; iter++)
+        fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%ld,"
+                      "\"ts\":%llu.%03u,\"dur\":%llu.%03u}",
+                zbuf[iter].name, (zbuf[iter].ztid) ? "cpu" : "gpu", zbuf[iter].ztid,
+                (unsigned long long)(zbuf[iter].tbgn / 1000), (unsigned)(zbuf[iter].tbgn % 1000),
+                (unsigned long long)((zbuf[iter].tend - zbuf[iter].tbgn) / 1000),
+                (unsigned)((zbuf[iter].tend - zbuf[iter].tbgn) % 1000));
+    fprintf(file, "\n]}\n");
+    retn = !ferror(file);
+    retn = !fclose(file) && retn;
+    return retn;
+}
+#endif
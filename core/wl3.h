@@ -0,0 +1,132 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+
+
+#define I16_SWAP(v) ((int16_t)(((uint16_t)(v) >> 8) | ((uint16_t)(v) << 8)))
+#define U16_SWAP(v) ((uint16_t)I16_SWAP(v))
+#define I32_SWAP(v) ((int32_t)(U16_SWAP((uint32_t)(v) >> 16) | (U16_SWAP(v) << 16)))
+#define U32_SWAP(v) ((uint32_t)I32_SWAP(v))
+
+/// profiler zones, built with -DPRF_ZONES only, and nothing at all without:
+/// PRF_BGN() opens a zone in a variable of the given name, PRF_END() closes
+/// it under a name that is not even evaluated when zones are compiled out
+#ifdef PRF_ZONES
+#define PRF_BGN(zone) uint64_t zone = rTimeNow()
+#define PRF_END(zone, name) rZoneAdd(name, false, zone, rTimeNow())
+#define PRF_SAVE() rZoneSave()
+#else
+#define PRF_BGN(zone)
+#define PRF_END(zone, name)
+#define PRF_SAVE()
+#endif
+
+
+
+typedef struct {
+    char *fptr;  /** file contents, read-only               **/
+    long  flen;  /** file length                            **/
+    bool  fmap;  /** true if mapped, false if malloc`ed     **/
+} FMAP;
+
+#pragma pack(push, 1)
+struct WL3H {           // Main Header
+    uint32_t offsPart;  // offset of the Part Table
+    uint32_t offsUnk;   // offset to some (W,W,D,D,D,D) block of unknown purpose
+    uint32_t offsColi;  // the game refers to this value as 'offset to colitab', purpose unknown
+    uint32_t offsTail;  // offset to some array at the very end of the file
+
+    uint32_t numPart;   // size of the Part Table
+
+    uint32_t numVert;   // total vertex count
+    uint32_t numPrim;   // total primitive count
+
+    uint32_t unk1[9];   // UNKNOWN
+    uint32_t unk2[3];   // UNKNOWN
+
+    uint8_t name[16];   // name of the model
+    uint16_t hdrSize;   // remaining header size
+    uint16_t hdrObjs;   // remaining header object count
+};
+struct PART {           // Part Table
+    uint32_t pidx;      // offset: prim indices
+    uint32_t vert;      // offset: vertices
+    uint32_t texc;      // offset: texture coords
+    uint32_t pnrm;      // offset: per-prim normals
+    uint32_t vnrm;      // offset: per-vertex normals
+    uint32_t attr;      // offset: prim attributes
+
+    uint32_t numVert;   // vertex count for this part
+    uint32_t numPrim;   // primitive count for this part
+
+    uint32_t unk1[2];   // UNKNOWN
+
+    uint32_t offset[4]; // offsets: [scale, X, Y, Z]
+
+    uint32_t unk2[3];   // UNKNOWN, probably a vector
+    uint32_t unk3;      // UNKNOWN
+
+    uint16_t always0C;  // theoretically should be the size of unk6, but seems to be fixed
+    uint16_t unk5;      // UNKNOWN
+    uint32_t unk6[3];   // UNKNOWN, [2] gets initialized with '-2'
+
+    uint8_t tex[12];    // texture ID
+
+    uint16_t partSize;  // remaining part size
+    uint16_t partObjs;  // remaining part object count
+};
+#pragma pack(pop)
+
+/// a part with its blocks located; index and vertex blocks are big-endian,
+/// the counts are already swapped
+typedef struct {
+    struct PART *part;
+    uint16_t *tidx, *qidx;  /** triangle & quad indices, past the counts **/
+    int16_t  *vert;         /** vertices                                 **/
+    uint8_t  *texc;         /** texcoords, past the count                **/
+    int8_t   *pnrm, *vnrm;  /** prim & vertex normals                    **/
+    uint16_t *attr;         /** prim attributes                          **/
+    long tri, qua;          /** triangle & quad counts, from the blocks  **/
+    long nvtx, nprm;        /** vertex & prim counts, from the header    **/
+} PBLK;
+
+/// what rFileStats() finds out about a file without decoding it
+typedef struct {
+    long flen;              /** file length                              **/
+    long offs[4];           /** offsPart, offsUnk, offsColi, offsTail    **/
+    long hprt, hvtx, hprm;  /** part, vertex & prim counts, per header   **/
+    long hsiz, hobj;        /** remaining header size & object count     **/
+    char name[17];          /** model name, 0-terminated                 **/
+    long cprt;              /** parts in the Part Table                  **/
+    long tri, qua, vtx;     /** triangles, quads & vertices of the parts **/
+    long cbnd;              /** parts with vertices, 0 = no bounds       **/
+    float bmin[3], bmax[3]; /** bounding box, as the renderer places it  **/
+    uint8_t (*ptex)[12];    /** distinct texture IDs, in order of use... **/
+    long ctex;              /** ...and their count                       **/
+    uint64_t tpar;          /** time it all took, ns                     **/
+} FSTA;
+
+/** rDumpTags() formats **/
+enum {
+    TAG_XML,  /** wxHexEditor XML                        **/
+    TAG_JSON, /** JSON lines: the file, then one per tag **/
+    TAG_BIN,  /** binary records, see TREC in wl3.c      **/
+};
+
+
+
+char *rLoadFile(char *name, long *size);
+bool rMapFile(FMAP *fmap, char *name);
+void rFreeFile(FMAP *fmap);
+struct PART *rPartAt(char *file, long indx, long *cprt);
+bool rPartBlocks(PBLK *pblk, char *file, long indx);
+bool rFileStats(FSTA *fsta, char *name);
+void rFreeStats(FSTA *fsta);
+uint64_t rTimeNow(void);
+long rCountCPUs(void);
+void rParallelFor(long size, void (*func)(void*, long), void *user);
+bool rDumpTags(int dest, char *name, long tfmt);
+#ifdef PRF_ZONES
+void rZoneAdd(char *name, bool gpuz, uint64_t tbgn, uint64_t tend);
+bool rZoneSave(void);
+#endif
@@ -0,0 +1,238 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include "../core/ogl_load/ogl_load.h"
+#include "../core/core.h"
+#include "../core/wl3.h"
+
+
+
+#define DEF_FRMS 300  /** Default number of frames to time      **/
+#define DEF_WARM 10   /** Default number of frames to throw out **/
+#define DEF_XDIM 800  /** Default surface width                 **/
+#define DEF_YDIM 600  /** Default surface height                **/
+
+typedef struct {
+    float ftrn[3]; /** camera position                        **/
+    float fang[2]; /** camera yaw and pitch, in radians       **/
+} POSE;
+
+typedef struct {
+    EGLDisplay disp;
+    EGLContext ectx;
+    GLuint fbuf, rbuf[2];
+} SURF;
+
+
+
+/// a GL 3.2 core context with nothing to show it on: Mesa gives one even
+/// with no GPU and no display server (llvmpipe, surfaceless platform),
+/// and the frames go to a framebuffer object of the requested size
+bool MakeSurface(SURF *surf, long xdim, long ydim) {
+    EGLint catr[] = {EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE},
+           xatr[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 2,
+                     EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+    PFNEGLGETPLATFORMDISPLAYEXTPROC gpde;
+    EGLConfig conf;
+    EGLint ccfg;
+
+    surf->disp = EGL_NO_DISPLAY;
+    if ((gpde = (void*)eglGetProcAddress("eglGetPlatformDisplayEXT")))
+        surf->disp = gpde(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+    if (surf->disp == EGL_NO_DISPLAY)
+        surf->disp = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if ((surf->disp == EGL_NO_DISPLAY) || !eglInitialize(surf->disp, 0, 0)
+    ||  !eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(surf->disp, catr, &conf, 1, &ccfg) || !ccfg)
+        return false;
+    surf->ectx = eglCreateContext(surf->disp, conf, EGL_NO_CONTEXT, xatr);
+    if ((surf->ectx == EGL_NO_CONTEXT)
+    ||  !eglMakeCurrent(surf->disp, EGL_NO_SURFACE, EGL_NO_SURFACE, surf->ectx))
+        return false;
+
+    glGenRenderbuffers(2, surf->rbuf);
+    glBindRenderbuffer(GL_RENDERBUFFER, surf->rbuf[0]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, xdim, ydim);
+    glBindRenderbuffer(GL_RENDERBUFFER, surf->rbuf[1]);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, xdim, ydim);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    glGenFramebuffers(1, &surf->fbuf);
+    glBindFramebuffer(GL_FRAMEBUFFER, surf->fbuf);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, surf->rbuf[0]);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, surf->rbuf[1]);
+    return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+void FreeSurface(SURF *surf) {
+    if (surf->disp == EGL_NO_DISPLAY)
+        return;
+    if (surf->ectx != EGL_NO_CONTEXT) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &surf->fbuf);
+        glDeleteRenderbuffers(2, surf->rbuf);
+        eglMakeCurrent(surf->disp, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(surf->disp, surf->ectx);
+    }
+    eglTerminate(surf->disp);
+}
+
+
+
+/// one pose per line: X Y Z yaw pitch, angles in degrees; '#' comments
+long ReadPoses(POSE **pose, char *name) {
+    long size = 0;
+    char line[256];
+    FILE *file;
+    POSE temp;
+
+    if (!(file = fopen(name, "r")))
+        return 0;
+    while (fgets(line, sizeof(line), file))
+        if ((line[0] != '#')
+        &&  (sscanf(line, "%f %f %f %f %f", &temp.ftrn[0], &temp.ftrn[1], &temp.ftrn[2],
+                                             &temp.fang[0], &temp.fang[1]) == 5)) {
+            temp.fang[0] *= M_PI / 180.0;
+            temp.fang[1] *= M_PI / 180.0;
+            *pose = realloc(*pose, (size + 1) * sizeof(**pose));
+            (*pose)[size++] = temp;
+        }
+    fclose(file);
+    return size;
+}
+
+/// with no script, the camera stays where the viewer puts it at start and
+/// turns around once over the timed frames
+long OrbitPoses(POSE **pose, ENGC *engc, long cfrm) {
+    POSE home;
+
+    cGetCamera(engc, home.ftrn, home.fang);
+    *pose = malloc(cfrm * sizeof(**pose));
+    for (long iter = 0; iter < cfrm; iter++) {
+        (*pose)[iter] = home;
+        (*pose)[iter].fang[0] = remainderf(home.fang[0] + 2.0 * M_PI * iter / cfrm, 2.0 * M_PI);
+    }
+    return cfrm;
+}
+
+bool SaveFrame(char *name, long xdim, long ydim) {
+    uint8_t *bptr = malloc(xdim * ydim * 4);
+    FILE *file;
+    bool retn;
+
+    glReadPixels(0, 0, xdim, ydim, GL_RGBA, GL_UNSIGNED_BYTE, bptr);
+    if ((retn = (file = fopen(name, "wb")))) {
+        fprintf(file, "P6\n%ld %ld\n255\n", xdim, ydim);
+        /// GL rows go bottom-up, PPM ones top-down
+        for (long y = ydim - 1; y >= 0; y--)
+            for (long x = 0; x < xdim; x++)
+                retn = (fwrite(&bptr[(y * xdim + x) * 4], 3, 1, file) == 1) && retn;
+        retn = !fclose(file) && retn;
+    }
+    free(bptr);
+    return retn;
+}
+
+int TimeOrder(const void *a, const void *b) {
+    return (*(uint64_t*)a > *(uint64_t*)b) - (*(uint64_t*)a < *(uint64_t*)b);
+}
+
+/// nearest-rank percentile of the sorted times, in milliseconds
+double Percentile(uint64_t *time, long size, double prct) {
+    long rank = ceil(prct / 100.0 * size);
+
+    return time[(rank < 1) ? 0 : rank - 1] / 1e6;
+}
+
+
+
+/// no window: renders the model offscreen from scripted camera poses, one
+/// frame after the other, and reports how long each frame took to finish
+int main(int argc, char *argv[]) {
+    long xdim = DEF_XDIM, ydim = DEF_YDIM, cfrm = DEF_FRMS, cwrm = DEF_WARM, cpos, dbug = 0;
+    char *fpos = 0, *fout = 0, *msck = 0;
+    SURF surf = {EGL_NO_DISPLAY, EGL_NO_CONTEXT};
+    uint64_t *time, tbgn, tsum = 0;
+    uint32_t flgs = 0;
+    POSE *pose = 0;
+    ENGC *engc;
+    int iter;
+
+    /// -g: decode on the GPU, -q: occlusion culling, -s WxH: surface size,
+    /// -n: frames to time, -w: warm-up frames, -p file: camera poses,
+    /// -o file: last frame as PPM, -m path: serve metrics on a Unix socket
+    /// while running, -d 1...4: the debug view F3...F6 would turn on
+    while ((iter = getopt(argc, argv, "gqs:n:w:p:o:m:d:")) != -1)
+        switch (iter) {
+            case 'g': flgs |= ENG_GPUDECODE; break;
+            case 'q': flgs |= ENG_OCCLUSION; break;
+            case 's': if (sscanf(optarg, "%ldx%ld", &xdim, &ydim) != 2) xdim = 0; break;
+            case 'n': cfrm = atol(optarg); break;
+            case 'w': cwrm = atol(optarg); break;
+            case 'p': fpos = optarg; break;
+            case 'o': fout = optarg; break;
+            case 'm': msck = optarg; break;
+            case 'd': dbug = atol(optarg); break;
+            default : exit(1);
+        }
+    if ((xdim < 1) || (ydim < 1) || (cfrm < 1) || (cwrm < 0) || (dbug < 0) || (dbug > KEY_F6 - KEY_F3 + 1)) {
+        printf("Invalid arguments! Exiting.\n");
+        exit(1);
+    }
+    if (optind >= argc) {
+        printf("No input files specified! Exiting.\n");
+        exit(1);
+    }
+    if (!MakeSurface(&surf, xdim, ydim)) {
+        printf("Cannot make an offscreen GL 3.2 surface! Exiting.\n");
+        FreeSurface(&surf);
+        exit(2);
+    }
+    printf("%s, %s\n", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    engc = cMakeEngine(argv[optind], flgs);
+    cResizeWindow(engc, xdim, ydim);
+    if (dbug) {
+        cKbdInput(engc, KEY_F3 + dbug - 1, 1, rTimeNow());
+        cKbdInput(engc, KEY_F3 + dbug - 1, 0, rTimeNow());
+    }
+    if (msck && !cServeStats(engc, msck))
+        fprintf(stderr, "'%s': cannot serve metrics there!\n", msck);
+    if (!(cpos = (fpos) ? ReadPoses(&pose, fpos) : OrbitPoses(&pose, engc, cfrm))) {
+        printf("'%s': no camera poses found! Exiting.\n", fpos);
+        cFreeEngine(&engc);
+        FreeSurface(&surf);
+        exit(2);
+    }
+
+    /// glFinish() is what makes it the time of the frame and not just of
+    /// the commands queued for it
+    time = malloc(cfrm * sizeof(*time));
+    for (long iter = -cwrm; iter < cfrm; iter++) {
+        POSE *curr = &pose[(iter + cwrm) % cpos];
+
+        cSetCamera(engc, curr->ftrn, curr->fang);
+        tbgn = rTimeNow();
+        cRedrawWindow(engc);
+        glFinish();
+        if (iter >= 0)
+            tsum += time[iter] = rTimeNow() - tbgn;
+        cSwapDone(engc);
+    }
+    if (fout && !SaveFrame(fout, xdim, ydim))
+        fprintf(stderr, "'%s': cannot save the frame!\n", fout);
+    qsort(time, cfrm, sizeof(*time), TimeOrder);
+    printf("'%s': %ld frames of %ldx%ld from %ld poses, %ld warm-up\n"
+           "  mean %.3f ms (%.1f FPS), min %.3f, p50 %.3f, p90 %.3f, p95 %.3f, p99 %.3f, max %.3f ms\n",
+           argv[optind], cfrm, xdim, ydim, cpos, cwrm, tsum / 1e6 / cfrm, 1e9 * cfrm / tsum,
+           time[0] / 1e6, Percentile(time, cfrm, 50), Percentile(time, cfrm, 90),
+           Percentile(time, cfrm, 95), Percentile(time, cfrm, 99), time[cfrm - 1] / 1e6);
+
+    free(time);
+    free(pose);
+    cFreeEngine(&engc);
+    FreeSurface(&surf);
+    return 0;
+}
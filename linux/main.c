@@ -1,41 +1,311 @@
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <X11/Xlib.h>
+#include <GL/glx.h>
 #include <gtk/gtk.h>
 #include <gtk/gtkgl.h>
+#include <gdk/gdkx.h>
+#include <gdk/gdkglx.h>
 
 #include "../core/core.h"
+#include "../core/wl3.h"
+
+
+
+#define DEF_RING 1024 /** Input ring size, a power of 2          **/
+#define DEF_MNEW 4    /** Fresh motion flag in RING::mmid        **/
+
+/** input events, as the render thread gets them **/
+enum {
+    EVT_KBD,  /** cKbdInput(): code, down                **/
+    EVT_MOUS, /** cMouseInput(): xpos, ypos, btns        **/
+    EVT_SIZE, /** cResizeWindow(): xpos, ypos            **/
+    EVT_DRAW, /** the window needs a new frame           **/
+    EVT_QUIT, /** the render thread has to exit          **/
+};
+
+typedef struct {
+    long type, code, xpos, ypos, btns;
+    uint64_t time;      /** rTimeNow() when the event came, or 0   **/
+} EVNT;
+
+/// single producer (the GTK thread), single consumer (the render thread),
+/// and not a lock between them: each side only ever writes its own index;
+/// motion that finds the ring full goes to a triple buffer instead, whose
+/// middle one the sides swap for their own, and the rest to a backlog that
+/// only the GTK thread sees, to be retried from its main loop
+typedef struct {
+    EVNT evnt[DEF_RING];
+    atomic_ulong head;  /** next slot to write, producer-owned     **/
+    atomic_ulong tail;  /** next slot to read, consumer-owned      **/
+    EVNT mous[3];       /** motion: the producer`s buffer, the     **/
+    long mprd, mcon;    /** consumer`s, and the middle one, plus   **/
+    atomic_long mmid;   /** DEF_MNEW when it holds a fresh motion  **/
+    atomic_bool dpnd;   /** a frame was asked for with no room     **/
+    EVNT *qbuf;         /** the backlog, in order from qbgn, and   **/
+    long qbgn, qend;    /** the GTK thread`s alone; it has room    **/
+    long qsiz;          /** for qsiz events, and gets retried by   **/
+    guint qtmr;         /** this timer source while not empty      **/
+} RING;
 
 typedef struct {
     GtkWidget *gwnd;
-    ENGC *engc;
+    Window xwnd;        /** the window as X sees it...             **/
+    XVisualInfo *xvis;  /** ...and the GL visual GTK gave it       **/
+    Display *disp;      /** the render thread's own X connection   **/
+    GLXContext xctx;    /** the GL 3.2 core context made on it     **/
+    char *name;
+    char *msck;         /** metrics socket path, 0 if none         **/
+    uint32_t flgs;
+    RING ring;
+    sem_t wake;         /** posted after each event pushed         **/
+    pthread_t thrd;
 } DATA;
 
 
 
-static inline GdkGLDrawable *gtk_widget_gl_begin(GtkWidget *gwnd) {
-    GdkGLDrawable *pGLD = gtk_widget_get_gl_drawable(gwnd);
+/// false when the ring has no room left, which the consumer alone changes
+bool RingPut(RING *ring, EVNT *evnt) {
+    unsigned long head = atomic_load_explicit(&ring->head, memory_order_relaxed);
 
-    if (!gdk_gl_drawable_gl_begin(pGLD, gtk_widget_get_gl_context(gwnd)))
-        return 0;
-    return pGLD;
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= DEF_RING)
+        return false;
+    ring->evnt[head % DEF_RING] = *evnt;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
 }
 
+/// takes the middle motion buffer back for the producer, so that the
+/// consumer cannot get it anymore; true if it held a motion not yet got
+bool MotionTake(RING *ring, EVNT *evnt) {
+    long mmid = atomic_exchange(&ring->mmid, ring->mprd);
 
+    ring->mprd = mmid & ~DEF_MNEW;
+    *evnt = ring->mous[ring->mprd];
+    return !!(mmid & DEF_MNEW);
+}
 
-gboolean DrawFunc(gpointer user) {
-    gdk_window_invalidate_rect(GDK_WINDOW(user), 0, FALSE);
-    gdk_window_process_updates(GDK_WINDOW(user), FALSE);
-    return TRUE;
+void MotionGive(RING *ring, EVNT *evnt) {
+    ring->mous[ring->mprd] = *evnt;
+    ring->mprd = atomic_exchange(&ring->mmid, ring->mprd | DEF_MNEW) & ~DEF_MNEW;
 }
 
+void BacklogAdd(RING *ring, EVNT *evnt) {
+    if (ring->qend == ring->qsiz)
+        ring->qbuf = realloc(ring->qbuf, (ring->qsiz += DEF_RING) * sizeof(*ring->qbuf));
+    ring->qbuf[ring->qend++] = *evnt;
+}
 
+/// moves as much of the backlog to the ring as fits; true if some is left
+bool BacklogFlush(RING *ring) {
+    while ((ring->qbgn < ring->qend) && RingPut(ring, &ring->qbuf[ring->qbgn]))
+        ring->qbgn++;
+    if (ring->qbgn == ring->qend)
+        ring->qbgn = ring->qend = 0;
+    return ring->qend > 0;
+}
 
-gboolean UpdateFunc(gpointer user) {
+gboolean OnBacklog(gpointer user) {
     DATA *data = (DATA*)user;
-    GdkGLDrawable *pGLD;
+    bool left = BacklogFlush(&data->ring);
 
-    pGLD = gtk_widget_gl_begin(data->gwnd);
-    cUpdateState(data->engc);
-    gdk_gl_drawable_gl_end(pGLD);
-    return TRUE;
+    sem_post(&data->wake);
+    if (!left)
+        data->ring.qtmr = 0;
+    return left;
+}
+
+/// the render thread may be stuck in a long import or a slow frame, and
+/// the GTK thread never waits for it: motion only matters as where the
+/// pointer ends up, so the motion that finds the ring full replaces the
+/// one that found it full before, and a frame asked for is just flagged;
+/// anything else that does not fit is kept in order in the backlog, and
+/// motion after it then replaces the motion last in the backlog, if any.
+/// Motion set aside keeps the time of the first motion it has replaced,
+/// as that is the input the next frame is late for
+void PushEvent(DATA *data, long type, long code, long xpos, long ypos, long btns, uint64_t time) {
+    EVNT evnt = {type, code, xpos, ypos, btns, time}, mous, *last;
+    bool move = (type == EVT_MOUS) && (btns & 1), mpnd;
+    RING *ring = &data->ring;
+
+    if (BacklogFlush(ring)) {
+        last = &ring->qbuf[ring->qend - 1];
+        if (type == EVT_DRAW)
+            atomic_store(&ring->dpnd, true);
+        else if (move && (last->type == EVT_MOUS) && (last->btns & 1))
+            *last = (EVNT){type, code, xpos, ypos, btns, last->time};
+        else
+            BacklogAdd(ring, &evnt);
+    }
+    else if (type == EVT_DRAW) {
+        if (!RingPut(ring, &evnt))
+            atomic_store(&ring->dpnd, true);
+    }
+    else {
+        /// the motion set aside, if still there, is either replaced or
+        /// has to go before this event
+        mpnd = MotionTake(ring, &mous);
+        if (move) {
+            evnt.time = (mpnd) ? mous.time : evnt.time;
+            if (!RingPut(ring, &evnt))
+                MotionGive(ring, &evnt);
+        }
+        else {
+            if (mpnd && !RingPut(ring, &mous))
+                BacklogAdd(ring, &mous);
+            if (ring->qend || !RingPut(ring, &evnt))
+                BacklogAdd(ring, &evnt);
+        }
+    }
+    if (ring->qend && !ring->qtmr)
+        ring->qtmr = g_timeout_add(1, OnBacklog, data);
+    sem_post(&data->wake);
+}
+
+/// motion set aside is newer than anything in the ring, so it goes last
+bool PopEvent(DATA *data, EVNT *evnt) {
+    unsigned long tail = atomic_load_explicit(&data->ring.tail, memory_order_relaxed);
+    long mmid;
+
+    if (tail == atomic_load_explicit(&data->ring.head, memory_order_acquire)) {
+        if (atomic_load(&data->ring.mmid) & DEF_MNEW) {
+            mmid = atomic_exchange(&data->ring.mmid, data->ring.mcon);
+            data->ring.mcon = mmid & ~DEF_MNEW;
+            *evnt = data->ring.mous[data->ring.mcon];
+            if (mmid & DEF_MNEW)
+                return true;
+        }
+        if (!atomic_exchange(&data->ring.dpnd, false))
+            return false;
+        *evnt = (EVNT){EVT_DRAW};
+        return true;
+    }
+    *evnt = data->ring.evnt[tail % DEF_RING];
+    atomic_store_explicit(&data->ring.tail, tail + 1, memory_order_release);
+    return true;
+}
+
+
+
+/// the core profile needs a context made from an FBConfig, so the one
+/// matching the visual GTK gave the window gets looked up; the server
+/// answers a version it cannot do with an X error, which is swallowed,
+/// since the default handler would otherwise bring the whole process down
+int OnXError(Display *disp, XErrorEvent *xerr) {
+    return 0;
+}
+
+/// GDK is not thread-safe, so the render thread keeps away from it: it
+/// talks to X over a connection of its own, and owns a GLX context made
+/// on it for the window GTK has set up with a GL visual; the context is
+/// made here, before that thread exists, so the error handler can be
+/// swapped without racing anything
+bool MakeContext(DATA *data) {
+    int attr[] = {GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+                  GLX_CONTEXT_MINOR_VERSION_ARB, 2,
+                  GLX_CONTEXT_PROFILE_MASK_ARB,
+                  GLX_CONTEXT_CORE_PROFILE_BIT_ARB, None};
+    PFNGLXCREATECONTEXTATTRIBSARBPROC ccat;
+    int (*xerr)(Display*, XErrorEvent*);
+    GLXFBConfig *cfbc;
+    int iter, nfbc, xvid;
+
+    data->xctx = 0;
+    if (!(data->disp = XOpenDisplay(0)))
+        return false;
+    ccat = (PFNGLXCREATECONTEXTATTRIBSARBPROC)
+           glXGetProcAddress((GLubyte*)"glXCreateContextAttribsARB");
+    if (ccat && (cfbc = glXGetFBConfigs(data->disp, data->xvis->screen,
+                                        &nfbc))) {
+        for (iter = 0; iter < nfbc; iter++)
+            if (!glXGetFBConfigAttrib(data->disp, cfbc[iter],
+                                      GLX_VISUAL_ID, &xvid)
+            &&  (VisualID)xvid == data->xvis->visualid)
+                break;
+        if (iter < nfbc) {
+            xerr = XSetErrorHandler(OnXError);
+            data->xctx = ccat(data->disp, cfbc[iter], 0, True, attr);
+            XSync(data->disp, False);
+            XSetErrorHandler(xerr);
+        }
+        XFree(cfbc);
+    }
+    if (data->xctx)
+        return true;
+    XCloseDisplay(data->disp);
+    return false;
+}
+
+void FreeContext(DATA *data) {
+    glXDestroyContext(data->disp, data->xctx);
+    XCloseDisplay(data->disp);
+}
+
+/// swap interval 1 if the driver has any way of setting it, so that each
+/// swap waits for the vertical blank and motion gets paced by the display
+void SetSwapInterval(void) {
+    int (*sint)(int);
+
+    if ((sint = (void*)glXGetProcAddress((GLubyte*)"glXSwapIntervalMESA"))
+    ||  (sint = (void*)glXGetProcAddress((GLubyte*)"glXSwapIntervalSGI")))
+        sint(1);
+}
+
+gboolean OnQuit(gpointer user) {
+    gtk_main_quit();
+    return FALSE;
+}
+
+
+
+/// owns the GL context and the engine from start to end: sleeps until
+/// there is input, applies all of it, then draws if anything has changed;
+/// while the camera moves it keeps drawing, paced by the swaps
+void *RenderFunc(void *user) {
+    DATA *data = (DATA*)user;
+    bool move = false, dirt = false;
+    ENGC *engc;
+    EVNT evnt;
+
+    /// with no GL there is nothing to show, so the GTK thread is asked to
+    /// quit, and the ring gets emptied until it does, so as not to fill up
+    if (!glXMakeCurrent(data->disp, data->xwnd, data->xctx)) {
+        fprintf(stderr, "Cannot make a GL context current! Exiting.\n");
+        g_idle_add(OnQuit, 0);
+        do
+            while (!PopEvent(data, &evnt))
+                sem_wait(&data->wake);
+        while (evnt.type != EVT_QUIT);
+        return 0;
+    }
+    SetSwapInterval();
+    engc = cMakeEngine(data->name, data->flgs);
+    if (data->msck && !cServeStats(engc, data->msck))
+        fprintf(stderr, "'%s': cannot serve metrics there!\n", data->msck);
+    while (true) {
+        if (!move && !dirt)
+            sem_wait(&data->wake);
+        while (PopEvent(data, &evnt))
+            switch (evnt.type) {
+                case EVT_KBD : dirt |= cKbdInput(engc, evnt.code, evnt.btns, evnt.time); break;
+                case EVT_MOUS: dirt |= cMouseInput(engc, evnt.xpos, evnt.ypos, evnt.btns, evnt.time); break;
+                case EVT_SIZE: dirt |= cResizeWindow(engc, evnt.xpos, evnt.ypos); break;
+                case EVT_DRAW: dirt = true; break;
+                case EVT_QUIT:
+                    cFreeEngine(&engc);
+                    glXMakeCurrent(data->disp, None, 0);
+                    return 0;
+            }
+        if (!move && !dirt)
+            continue;
+        move = cUpdateState(engc);
+        cRedrawWindow(engc);
+        glXSwapBuffers(data->disp, data->xwnd);
+        cSwapDone(engc);
+        dirt = false;
+    }
 }
 
 
@@ -48,10 +318,12 @@ gboolean OnDestroy(GtkWidget *gwnd, gpointer user) {
 
 
 gboolean OnMouseMove(GtkWidget *gwnd, GdkEventMotion *emov, gpointer user) {
-    cMouseInput(*(ENGC**)user, emov->x, emov->y,
-               ((emov->state & GDK_BUTTON1_MASK)? 2 : 0) |
-               ((emov->state & GDK_BUTTON2_MASK)? 4 : 0) |
-               ((emov->state & GDK_BUTTON3_MASK)? 8 : 0) | 1);
+    uint64_t time = rTimeNow();
+
+    PushEvent((DATA*)user, EVT_MOUS, 0, emov->x, emov->y,
+             ((emov->state & GDK_BUTTON1_MASK)? 2 : 0) |
+             ((emov->state & GDK_BUTTON2_MASK)? 4 : 0) |
+             ((emov->state & GDK_BUTTON3_MASK)? 8 : 0) | 1, time);
     return TRUE;
 }
 
@@ -59,11 +331,12 @@ gboolean OnMouseMove(GtkWidget *gwnd, GdkEventMotion *emov, gpointer user) {
 
 gboolean OnMousePress(GtkWidget *gwnd, GdkEventButton *ebtn, gpointer user) {
     long down = (ebtn->type == GDK_BUTTON_PRESS)? 1 : 0;
+    uint64_t time = rTimeNow();
 
-    cMouseInput(*(ENGC**)user, ebtn->x, ebtn->y,
-               ((ebtn->button == 1)? down << 1 : 0) |
-               ((ebtn->button == 2)? down << 2 : 0) |
-               ((ebtn->button == 3)? down << 3 : 0));
+    PushEvent((DATA*)user, EVT_MOUS, 0, ebtn->x, ebtn->y,
+             ((ebtn->button == 1)? down << 1 : 0) |
+             ((ebtn->button == 2)? down << 2 : 0) |
+             ((ebtn->button == 3)? down << 3 : 0), time);
     return TRUE;
 }
 
@@ -106,8 +379,10 @@ gboolean OnKeyPress(GtkWidget *gwnd, GdkEventKey *ekey, gpointer user) {
         KEY_NONE      , KEY_NONE      , KEY_NONE      , KEY_NONE      ,
         KEY_NONE      , KEY_LSYSTEM   , /** only KEY_NONE`s here... **/
     };
-    cKbdInput(*(ENGC**)user, keys[ekey->hardware_keycode & 0xFF],
-             (ekey->type == GDK_KEY_PRESS)? TRUE : FALSE);
+    uint64_t time = rTimeNow();
+
+    PushEvent((DATA*)user, EVT_KBD, keys[ekey->hardware_keycode & 0xFF], 0, 0,
+             (ekey->type == GDK_KEY_PRESS)? TRUE : FALSE, time);
     return TRUE;
 }
 
@@ -124,61 +399,73 @@ gboolean OnChange(GtkWidget *gwnd, GdkScreen *scrn, gpointer user) {
 
 
 gboolean OnResize(GtkWidget *gwnd, GdkEventConfigure *ecnf, gpointer user) {
-    GdkGLDrawable *pGLD;
-
-    pGLD = gtk_widget_gl_begin(gwnd);
-    cResizeWindow(*(ENGC**)user, ecnf->width, ecnf->height);
-    gdk_gl_drawable_gl_end(pGLD);
+    PushEvent((DATA*)user, EVT_SIZE, 0, ecnf->width, ecnf->height, 0, 0);
     return FALSE;
 }
 
 
 
 gboolean OnRedraw(GtkWidget *gwnd, GdkEventExpose *eexp, gpointer user) {
-    GdkGLDrawable *pGLD;
-
-    pGLD = gtk_widget_gl_begin(gwnd);
-    cRedrawWindow(*(ENGC**)user);
-    gdk_gl_drawable_swap_buffers(pGLD);
-    gdk_gl_drawable_gl_end(pGLD);
+    PushEvent((DATA*)user, EVT_DRAW, 0, 0, 0, 0, 0);
     return TRUE;
 }
 
 
 
 int main(int argc, char *argv[]) {
-    GdkGLDrawable *pGLD;
-    guint tmru, tmrd;
+    uint32_t flgs = 0;
     DATA data = {};
-
-    if (argc < 2) {
+    int iter;
+
+    /// -g: decode on the GPU, -q: occlusion culling, -m path: serve metrics
+    /// on a Unix socket; anything after the file name: dump XML
+    while ((iter = getopt(argc, argv, "gqm:")) != -1)
+        switch (iter) {
+            case 'g': flgs |= ENG_GPUDECODE; break;
+            case 'q': flgs |= ENG_OCCLUSION; break;
+            case 'm': data.msck = optarg; break;
+            default : exit(1);
+        }
+    if (optind >= argc) {
         printf("No input files specified! Exiting.\n");
         exit(1);
     }
+    /// the XML dump needs neither a window nor GL, so it goes before GTK
+    if (argc - optind >= 2) {
+        if (!rDumpTags(1, argv[optind], TAG_XML)) {
+            printf("'%s': cannot load the file! Exiting.\n", argv[optind]);
+            exit(2);
+        }
+        exit(0);
+    }
 
+    /// GTK calls come from this thread only, GLX ones from the render
+    /// thread only, on an X connection of its own; Xlib still has to know
+    /// that there are threads, since both connections live in one process
+    XInitThreads();
     gtk_init(0, 0);
     gtk_gl_init(0, 0);
     data.gwnd = gtk_window_new(GTK_WINDOW_TOPLEVEL);
     OnChange(data.gwnd, 0, 0);
 
     g_signal_connect(G_OBJECT(data.gwnd), "expose-event",
-                     G_CALLBACK(OnRedraw), &data.engc);
+                     G_CALLBACK(OnRedraw), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "delete-event",
-                     G_CALLBACK(OnDestroy), &data.engc);
+                     G_CALLBACK(OnDestroy), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "screen-changed",
-                     G_CALLBACK(OnChange), &data.engc);
+                     G_CALLBACK(OnChange), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "configure-event",
-                     G_CALLBACK(OnResize), &data.engc);
+                     G_CALLBACK(OnResize), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "key-press-event",
-                     G_CALLBACK(OnKeyPress), &data.engc);
+                     G_CALLBACK(OnKeyPress), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "key-release-event",
-                     G_CALLBACK(OnKeyPress), &data.engc);
+                     G_CALLBACK(OnKeyPress), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "button-press-event",
-                     G_CALLBACK(OnMousePress), &data.engc);
+                     G_CALLBACK(OnMousePress), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "button-release-event",
-                     G_CALLBACK(OnMousePress), &data.engc);
+                     G_CALLBACK(OnMousePress), &data);
     g_signal_connect(G_OBJECT(data.gwnd), "motion-notify-event",
-                     G_CALLBACK(OnMouseMove), &data.engc);
+                     G_CALLBACK(OnMouseMove), &data);
     gtk_widget_set_events(data.gwnd, gtk_widget_get_events(data.gwnd)
                                    | GDK_POINTER_MOTION_MASK
                                    | GDK_BUTTON_RELEASE_MASK
@@ -192,26 +479,42 @@ int main(int argc, char *argv[]) {
                                                          | GDK_GL_MODE_RGBA),
                                  0, TRUE, GDK_GL_RGBA_TYPE);
     gtk_widget_realize(data.gwnd);
+    data.xwnd = GDK_WINDOW_XID(gtk_widget_get_window(data.gwnd));
+    data.xvis = gdk_x11_gl_config_get_xvinfo(gtk_widget_get_gl_config(data.gwnd));
+    /// the window has to exist on the server before another connection
+    /// can make a context current on it
+    XSync(GDK_WINDOW_XDISPLAY(gtk_widget_get_window(data.gwnd)), False);
+    if (!MakeContext(&data)) {
+        printf("Cannot make a GL 3.2 core context! Exiting.\n");
+        gtk_widget_destroy(data.gwnd);
+        exit(2);
+    }
 
-    pGLD = gtk_widget_gl_begin(data.gwnd);
-    data.engc = cMakeEngine(argv[1], argc >= 3);
-    gdk_gl_drawable_gl_end(pGLD);
+    data.name = argv[optind];
+    data.flgs = flgs;
+    sem_init(&data.wake, 0, 0);
+    data.ring.mcon = 1;
+    data.ring.mmid = 2;
+    pthread_create(&data.thrd, 0, RenderFunc, &data);
 
     gtk_widget_set_app_paintable(data.gwnd, TRUE);
     gtk_widget_set_size_request(data.gwnd, 800, 600);
     gtk_window_set_position(GTK_WINDOW(data.gwnd), GTK_WIN_POS_CENTER);
     gtk_widget_show(data.gwnd);
 
-    tmru = g_timeout_add(DEF_UTMR, UpdateFunc, &data);
-    tmrd = g_idle_add(DrawFunc, gtk_widget_get_window(data.gwnd));
-
+    /// the render thread sleeps until there is input: expose events ask
+    /// for frames, input asks for them only when the view has changed
     gtk_main();
 
-    pGLD = gtk_widget_gl_begin(data.gwnd);
-    cFreeEngine(&data.engc);
-    gdk_gl_drawable_gl_end(pGLD);
+    /// with the main loop gone, nothing but this retries the backlog, and
+    /// nothing else is left to do on this thread
+    PushEvent(&data, EVT_QUIT, 0, 0, 0, 0, 0);
+    while (OnBacklog(&data))
+        sched_yield();
+    pthread_join(data.thrd, 0);
+    FreeContext(&data);
+    sem_destroy(&data.wake);
+    free(data.ring.qbuf);
 
-    g_source_remove(tmrd);
-    g_source_remove(tmru);
     gtk_widget_destroy(data.gwnd);
 }
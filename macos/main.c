@@ -1,6 +1,7 @@
 #include "mac_load/mac_load.h"
 #include "../core/ogl_load/ogl_load.h"
 #include "../core/core.h"
+#include "../core/wl3.h"
 
 
 
@@ -43,6 +44,7 @@ void MAC_Handler(OnDraw, CGRect rect) {
     MAC_GetIvar(self, VAR_ENGC, &engc);
     cRedrawWindow(engc);
     flushBuffer(openGLContext(self));
+    cSwapDone(engc);
 }
 
 void MAC_Handler(OnKeys, NSEvent *ekey) {
@@ -84,7 +86,7 @@ void MAC_Handler(OnKeys, NSEvent *ekey) {
     ENGC *engc;
 
     MAC_GetIvar(self, VAR_ENGC, &engc);
-    cKbdInput(engc, keys[keyCode(ekey) & 0xFF], !!(type(ekey) == NSKeyDown));
+    cKbdInput(engc, keys[keyCode(ekey) & 0xFF], !!(type(ekey) == NSKeyDown), rTimeNow());
 }
 
 void OnRedraw(CFRunLoopObserverRef runp, CFRunLoopActivity acti, void *user) {
@@ -115,7 +117,7 @@ void OnUpdate(CFRunLoopTimerRef tmrp, void *user) {
         if ((~attr & 1) && (here || ((data->pbtn >> 8) & ~attr & 14)))
             data->pbtn = (data->pbtn & 0xFF) | ((attr & 14) << 8);
         if ((data->pbtn & (14 << 8)))
-            cMouseInput(data->engc, mptr.x, mptr.y, attr);
+            cMouseInput(data->engc, mptr.x, mptr.y, attr, rTimeNow());
     }
     cUpdateState(data->engc);
 }
@@ -123,7 +125,8 @@ void OnUpdate(CFRunLoopTimerRef tmrp, void *user) {
 
 
 int main(int argc, char *argv[]) {
-    GLint attr[] = {NSOpenGLPFADoubleBuffer, NSOpenGLPFADepthSize, 32, 0};
+    GLint attr[] = {NSOpenGLPFAOpenGLProfile, NSOpenGLProfileVersion3_2Core,
+                    NSOpenGLPFADoubleBuffer, NSOpenGLPFADepthSize, 32, 0};
     CFRunLoopTimerRef tupd;
     CFRunLoopObserverRef idrw;
     NSOpenGLPixelFormat *pfmt;
@@ -152,7 +155,11 @@ int main(int argc, char *argv[]) {
                                        keyDown_(), OnKeys, keyUp_(), OnKeys,
                                        acceptsFirstResponder(), OnTrue));
 
-    pfmt = initWithAttributes_(alloc(NSOpenGLPixelFormat()), attr);
+    /// without the profile attribute Cocoa hands out a 2.1 legacy context
+    if (!(pfmt = initWithAttributes_(alloc(NSOpenGLPixelFormat()), attr))) {
+        printf("Cannot make a GL 3.2 core context! Exiting.\n");
+        exit(2);
+    }
     data.view = (NSView*)initWithFrame_pixelFormat_(alloc(vogl), dims, pfmt);
     makeCurrentContext(openGLContext(data.view));
     release(pfmt);
@@ -7,6 +7,41 @@
 #include <commctrl.h>
 
 #include "../core/core.h"
+#include "../core/wl3.h"
+
+#ifndef WGL_CONTEXT_MAJOR_VERSION_ARB
+#define WGL_CONTEXT_MAJOR_VERSION_ARB    0x2091
+#define WGL_CONTEXT_MINOR_VERSION_ARB    0x2092
+#define WGL_CONTEXT_PROFILE_MASK_ARB     0x9126
+#define WGL_CONTEXT_CORE_PROFILE_BIT_ARB 0x0001
+#endif
+
+
+
+/// the core profile is only reachable through an extension, which in
+/// turn only resolves while some context is current: a legacy one gets
+/// made for the lookup, and is thrown away once the real one exists
+HGLRC MakeContext(HDC mwdc) {
+    int attr[] = {WGL_CONTEXT_MAJOR_VERSION_ARB, 3,
+                  WGL_CONTEXT_MINOR_VERSION_ARB, 2,
+                  WGL_CONTEXT_PROFILE_MASK_ARB,
+                  WGL_CONTEXT_CORE_PROFILE_BIT_ARB, 0};
+    HGLRC (APIENTRY *ccat)(HDC, HGLRC, const int*);
+    HGLRC temp, retn = 0;
+
+    if (!(temp = wglCreateContext(mwdc)))
+        return 0;
+    if (wglMakeCurrent(mwdc, temp)
+    && (ccat = (void*)wglGetProcAddress("wglCreateContextAttribsARB")))
+        retn = ccat(mwdc, 0, attr);
+    wglMakeCurrent(0, 0);
+    wglDeleteContext(temp);
+    if (retn && !wglMakeCurrent(mwdc, retn)) {
+        wglDeleteContext(retn);
+        retn = 0;
+    }
+    return retn;
+}
 
 
 
@@ -118,7 +153,8 @@ HRESULT APIENTRY WindowProc(HWND hWnd, UINT uMsg, WPARAM wPrm, LPARAM lPrm) {
                 #undef WIN_MKEY
             }
             cKbdInput((ENGC*)GetWindowLongPtr(hWnd, GWLP_USERDATA),
-                       keys[wPrm & 0xFF], (uMsg == WM_KEYDOWN)? TRUE : FALSE);
+                       keys[wPrm & 0xFF], (uMsg == WM_KEYDOWN)? TRUE : FALSE,
+                       rTimeNow());
             return 0;
 
         case WM_LBUTTONUP:
@@ -138,7 +174,8 @@ HRESULT APIENTRY WindowProc(HWND hWnd, UINT uMsg, WPARAM wPrm, LPARAM lPrm) {
             cMouseInput((ENGC*)GetWindowLongPtr(hWnd, GWLP_USERDATA), movp.x,
                          movp.y, ((uMsg == WM_LBUTTONDOWN)? 1 << 1 : 0) |
                                  ((uMsg == WM_MBUTTONDOWN)? 1 << 2 : 0) |
-                                 ((uMsg == WM_RBUTTONDOWN)? 1 << 3 : 0));
+                                 ((uMsg == WM_RBUTTONDOWN)? 1 << 3 : 0),
+                         rTimeNow());
             return 0;
 
         case WM_MOUSEMOVE:
@@ -147,7 +184,8 @@ HRESULT APIENTRY WindowProc(HWND hWnd, UINT uMsg, WPARAM wPrm, LPARAM lPrm) {
             cMouseInput((ENGC*)GetWindowLongPtr(hWnd, GWLP_USERDATA), movp.x,
                          movp.y, ((wPrm & MK_LBUTTON)? 2 : 0) |
                                  ((wPrm & MK_MBUTTON)? 4 : 0) |
-                                 ((wPrm & MK_RBUTTON)? 8 : 0) | 1);
+                                 ((wPrm & MK_RBUTTON)? 8 : 0) | 1,
+                         rTimeNow());
             return 0;
 
         case WM_SIZE: {
@@ -199,7 +237,10 @@ int APIENTRY WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmdl, int show) {
     mwdc = GetDC(hwnd);
     ppfd.iLayerType = PFD_MAIN_PLANE;
     SetPixelFormat(mwdc, ChoosePixelFormat(mwdc, &ppfd), &ppfd);
-    wglMakeCurrent(mwdc, mwrc = wglCreateContext(mwdc));
+    if (!(mwrc = MakeContext(mwdc))) {
+        printf("Cannot make a GL 3.2 core context! Exiting.\n");
+        exit(2);
+    }
     SetWindowLongPtr(hwnd, GWLP_USERDATA, (LONG_PTR)(engc = cMakeEngine()));
 
     rect.right = 800;
@@ -224,6 +265,7 @@ int APIENTRY WinMain(HINSTANCE inst, HINSTANCE prev, LPSTR cmdl, int show) {
         }
         cRedrawWindow(engc);
         SwapBuffers(mwdc);
+        cSwapDone(engc);
     }
     cFreeEngine(&engc);
     wglMakeCurrent(0, 0);